@@ -0,0 +1,1725 @@
+//  Headless benchmark: renders and encodes frames for a scripted walk through the maze without a
+// terminal with various render settings and reports how long that takes. Usage:
+//
+//     wsterm_bench [width] [height] [frames]
+//
+// Every heap allocation is counted so that we can check that steady-state frames (i.e. everything
+// after the first two frames) never touch the heap. In debug builds a steady-state allocation is an error.
+
+#include <bsp.hpp>
+#include <encoder.hpp>
+#include <frame_arena.hpp>
+#include <map.hpp>
+#include <player.hpp>
+#include <renderer.hpp>
+#include <resolution_controller.hpp>
+#include <sprites.hpp>
+#include <wall_hit_table.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <new>
+#include <numbers>
+#include <random>
+#include <ranges>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    std::atomic<std::size_t> allocations = 0;
+}
+
+void* operator new(const std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace
+{
+    // The number of checks that found steady-state allocations or results that differ from their reference. The
+    // benchmark fails if any check does.
+    auto failed_checks = std::size_t{0};
+
+    // Pass on a count of allocations or differences for printing, counting the check as failed if it is not zero
+    std::size_t expect_zero(const std::size_t count)
+    {
+        failed_checks += (count != 0) ? 1 : 0;
+        return count;
+    }
+
+    //  A hardware event counter for this thread (e.g. cache misses), if the system lets us have one (on Linux
+    // with perf events that are not restricted). Otherwise the counter is not valid and always reads zero.
+    class perf_counter
+    {
+    public:
+        perf_counter(const std::uint32_t type, const std::uint64_t config)
+        {
+#if defined(__linux__)
+            auto attributes = perf_event_attr{};
+            attributes.size = sizeof(attributes);
+            attributes.type = type;
+            attributes.config = config;
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+        }
+
+        perf_counter(const perf_counter&) = delete;
+        perf_counter& operator=(const perf_counter&) = delete;
+
+        ~perf_counter()
+        {
+#if defined(__linux__)
+            if (is_valid()) close(fd_);
+#endif
+        }
+
+        [[nodiscard]] bool is_valid() const { return fd_ >= 0; }
+
+        void start()
+        {
+#if defined(__linux__)
+            if (!is_valid()) return;
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+
+        std::uint64_t stop()
+        {
+            auto count = std::uint64_t{0};
+#if defined(__linux__)
+            if (!is_valid()) return 0;
+            ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd_, &count, sizeof(count)) != sizeof(count)) count = 0;
+#endif
+            return count;
+        }
+
+    private:
+        int fd_ = -1;
+    };
+
+    // The camera path: walk and turn at the same time, i.e. go round in circles (sliding along walls)
+    std::vector<player> camera_path(const int num_frames)
+    {
+        constexpr auto dt = 1.0f / 60.0f;
+        auto path = std::vector<player>(static_cast<std::size_t>(std::max(0, num_frames)));
+        auto plyr = player{};
+        for (auto& p : path)
+        {
+            plyr.turn(1.0f, dt);
+            plyr.walk(0.5f, dt);
+            p = plyr;
+        }
+
+        return path;
+    }
+
+    //  Render and encode every frame of the camera path with the given settings and print a line with the
+    // average frame time, encoded bytes, style (attribute or color) changes, rays cast and resolution scale per
+    // frame and the number of steady-state allocations. If a target frame time is given, the resolution is
+    // adjusted dynamically to meet it.
+    void benchmark(const char* name, const std::vector<player>& path, const std::pair<int, int>& screen_size,
+                   render_settings settings, const float target_frame_time_ms = 0.0f)
+    {
+        auto screen = screen_buffers(screen_size);
+        auto arena = frame_arena{};
+        auto resolution = resolution_controller(resolution_controller::milliseconds(target_frame_time_ms));
+        auto bytes = std::size_t{0};
+        auto style_changes = std::size_t{0};
+        auto rays = std::size_t{0};
+        auto scale = 0.0;
+
+        const auto run_frame = [&](const player& plyr) {
+            const auto frame_start = std::chrono::steady_clock::now();
+            arena.reset();
+            const auto stats = render(screen, plyr, settings, arena);
+            const auto encoded = kernels_for(settings.kernel_isa).encode_changes(screen.frame, screen.presented, arena);
+            std::swap(screen.frame, screen.presented);
+            bytes += encoded.bytes;
+            style_changes += encoded.style_changes;
+            rays += stats.rays.rays_cast;
+            scale += stats.resolution_scale;
+
+            if (target_frame_time_ms > 0.0f)
+            {
+                const auto frame_time = std::chrono::steady_clock::now() - frame_start;
+                settings.column_step = resolution.update(resolution_controller::milliseconds(frame_time));
+            }
+        };
+
+        // the first frame finds out how much scratch memory a frame needs and the reset at the start of
+        // the second frame grows the arena accordingly. Everything after that is steady state.
+        run_frame(player{});
+        run_frame(player{});
+        bytes = style_changes = rays = 0;
+        scale = 0.0;
+
+        const auto allocations_before = allocations.load();
+        const auto start = std::chrono::steady_clock::now();
+
+        for (const auto& plyr : path)
+            run_frame(plyr);
+
+        const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+        const auto steady_state_allocations = allocations.load() - allocations_before;
+
+        const auto num_frames = static_cast<double>(std::max<std::size_t>(1, path.size()));
+        std::printf("%-20s %10.4f %10.0f %10.1f %10.1f %10.2f %12zu\n", name, elapsed.count() / num_frames,
+                    static_cast<double>(bytes) / num_frames, static_cast<double>(style_changes) / num_frames,
+                    static_cast<double>(rays) / num_frames, scale / num_frames, expect_zero(steady_state_allocations));
+
+    }
+
+    //  The number of columns (over the whole camera path) where the wall hits computed by compute differ from
+    // those computed by casting a ray for every column through the map. This should always be zero.
+    template <typename Map, typename ComputeWallHits>
+    std::size_t count_mismatches(const Map& map, const std::vector<player>& path, const int width,
+                                 const ComputeWallHits& compute)
+    {
+        const auto screen = screen_buffers({width, 1});
+        auto arena = frame_arena{};
+        auto exact = std::vector<wall_hit>(screen.ray_offsets.size());
+        auto other = std::vector<wall_hit>(screen.ray_offsets.size());
+
+        auto mismatches = std::size_t{0};
+        for (const auto& plyr : path)
+        {
+            arena.reset();
+            const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(screen.ray_offsets[i]); };
+            compute_wall_hits(map, std::span(exact), plyr.pos(), ray_dir, 1);
+            compute(std::span(other), plyr, std::span<const float>(screen.ray_offsets), arena);
+            for (std::size_t i = 0; i < exact.size(); ++i)
+                if ((exact[i].distance != other[i].distance) or (exact[i].tx != other[i].tx)) ++mismatches;
+        }
+
+        return mismatches;
+    }
+
+    template <typename Map>
+    auto span_coherence(const Map& map)
+    {
+        return [&map](const std::span<wall_hit> hits, const player& plyr, const std::span<const float> ray_offsets,
+                      frame_arena&) {
+            const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(ray_offsets[i]); };
+            return compute_wall_hits(map, hits, plyr.pos(), ray_dir, render_settings{}.span_width);
+        };
+    }
+
+    template <typename Map>
+    auto bsp(const Map& map, const bsp_tree& tree)
+    {
+        return [&map, &tree](const std::span<wall_hit> hits, const player& plyr,
+                             const std::span<const float> ray_offsets, frame_arena& arena) {
+            return tree.compute_wall_hits(map, hits, plyr.view(), ray_offsets, arena);
+        };
+    }
+
+    // Average time in milliseconds to call draw for each frame (e.g. the poses of the camera path)
+    template <typename Frames, typename Draw>
+    double milliseconds_per_frame(const Frames& frames, const Draw& draw)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto& frame : frames)
+            draw(frame);
+
+        const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+        return elapsed.count() / static_cast<double>(std::max<std::size_t>(1, std::ranges::size(frames)));
+    }
+
+    // Average time in milliseconds to compute the wall hits for all columns for each pose of the camera path
+    template <typename ComputeWallHits>
+    double milliseconds_per_frame(const std::vector<player>& path, const int width, const ComputeWallHits& compute)
+    {
+        const auto screen = screen_buffers({width, 1});
+        auto arena = frame_arena{};
+        auto hits = std::vector<wall_hit>(screen.ray_offsets.size());
+
+        return milliseconds_per_frame(path, [&](const player& plyr) {
+            arena.reset();
+            compute(std::span(hits), plyr, std::span<const float>(screen.ray_offsets), arena);
+        });
+    }
+
+    // The wall hits in the maze of the rays with the given offsets (see screen_buffers) for each pose of the path
+    std::vector<std::vector<wall_hit>> wall_hits_along_path(const std::vector<player>& path,
+                                                            const std::span<const float> ray_offsets)
+    {
+        auto frame_hits = std::vector<std::vector<wall_hit>>();
+        for (const auto& plyr : path)
+        {
+            auto& hits = frame_hits.emplace_back(ray_offsets.size());
+            const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(ray_offsets[i]); };
+            compute_wall_hits(maze_map{}, std::span(hits), plyr.pos(), ray_dir, 1);
+        }
+        return frame_hits;
+    }
+
+    //  How good the approximation of the progressive wall caster is for a range of ray budgets: the fraction of
+    // columns computed exactly and the mean and maximum relative error of the wall distance over all columns
+    // (compared to casting a ray for every column).
+    void benchmark_ray_budgets(const std::vector<player>& path, const int width)
+    {
+        std::printf("%-14s %10s %10s %12s %12s\n", "budget ms", "ms", "exact", "mean error", "max error");
+
+        const auto screen = screen_buffers({width, 1});
+        const auto maze = maze_map{};
+        auto arena = frame_arena{};
+        auto exact = std::vector<wall_hit>(screen.ray_offsets.size());
+        auto approximate = std::vector<wall_hit>(screen.ray_offsets.size());
+
+        for (const auto budget_ms : {0.0005, 0.001, 0.002, 0.005, 0.01, 1.0})
+        {
+            const auto budget = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::milli>(budget_ms));
+            auto elapsed = std::chrono::duration<double, std::milli>(0);
+            auto exact_columns = std::size_t{0};
+            auto error_sum = 0.0;
+            auto max_error = 0.0;
+
+            for (const auto& plyr : path)
+            {
+                arena.reset();
+                const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(screen.ray_offsets[i]); };
+                compute_wall_hits(maze, std::span(exact), plyr.pos(), ray_dir, 1);
+
+                const auto start = std::chrono::steady_clock::now();
+                const auto is_over_budget = [deadline = start + budget] {
+                    return std::chrono::steady_clock::now() > deadline;
+                };
+                const auto stats = compute_wall_hits_progressive(maze, std::span(approximate), plyr.pos(), ray_dir,
+                                                                 render_settings{}.span_width, ray_limits{},
+                                                                 ray_options{}, is_over_budget, arena);
+                elapsed += std::chrono::steady_clock::now() - start;
+                exact_columns += stats.columns - stats.columns_approximated;
+
+                for (std::size_t i = 0; i < exact.size(); ++i)
+                {
+                    const auto error = std::abs(static_cast<double>(approximate[i].distance - exact[i].distance)) /
+                                       static_cast<double>(exact[i].distance);
+                    error_sum += error;
+                    max_error = std::max(max_error, error);
+                }
+            }
+
+            const auto num_frames = static_cast<double>(std::max<std::size_t>(1, path.size()));
+            const auto num_columns = num_frames * static_cast<double>(std::max<std::size_t>(1, exact.size()));
+            std::printf("%-14.4f %10.4f %10.2f %12.4f %12.4f\n", budget_ms, elapsed.count() / num_frames,
+                        static_cast<double>(exact_columns) / num_columns, error_sum / num_columns, max_error);
+        }
+    }
+
+    // Any map that counts how many cells are looked up (i.e. how many cells a ray visits)
+    template <typename Map>
+    struct counting_map
+    {
+        const Map& map;
+        mutable std::size_t lookups = 0;
+
+        [[nodiscard]] bool is_wall(const vec2i& pos) const
+        {
+            ++lookups;
+            return map.is_wall(pos);
+        }
+        [[nodiscard]] int width() const { return map.width(); }
+        [[nodiscard]] int height() const { return map.height(); }
+    };
+
+    //  The distribution of the number of cells a ray visits and the time to cast a ray for every column with
+    // and without ray limits, on the maze and on a huge field with pillars, both closed and open (i.e. without
+    // the border wall, which only works with limits). The camera spins on the spot in the middle of the map.
+    void benchmark_ray_limits(const int width)
+    {
+        std::printf("%-12s %10s %10s %10s %8s %8s %8s %8s %10s\n", "map", "far plane", "max steps", "ms", "p50",
+                    "p90", "p99", "max", "misses");
+
+        constexpr auto field_size = 4096;
+        const auto closed_field = generate_map(field_size, field_size, field_size);
+        auto open_field = closed_field;
+        for (int i = 0; i < field_size; ++i)
+        {
+            for (const auto pos : {vec2i{i, 0}, vec2i{0, i}, vec2i{i, field_size - 1}, vec2i{field_size - 1, i}})
+                open_field.set_wall(pos, false);
+        }
+
+        const auto run = [&](const char* name, const auto& map, const vec2f& center, const ray_limits& limits) {
+            auto path = std::vector<player>(100, player(center));
+            for (std::size_t i = 1; i < path.size(); ++i)
+            {
+                path[i] = path[i - 1];
+                path[i].turn(1.0f, 1.0f / 15.0f);
+            }
+
+            const auto cast_every_column = [&](const std::span<wall_hit> hits, const player& plyr,
+                                               const std::span<const float> ray_offsets, frame_arena&) {
+                const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(ray_offsets[i]); };
+                return compute_wall_hits(map, hits, plyr.pos(), ray_dir, 1, 1, limits);
+            };
+            const auto milliseconds = milliseconds_per_frame(path, width, cast_every_column);
+
+            const auto screen = screen_buffers({width, 1});
+            const auto counting = counting_map<std::decay_t<decltype(map)>>{.map = map};
+            auto cells_visited = std::vector<std::size_t>();
+            auto misses = std::size_t{0};
+            for (const auto& plyr : path)
+            {
+                for (const auto offset : screen.ray_offsets)
+                {
+                    counting.lookups = 0;
+                    misses += find_wall_face(counting, plyr.pos(), plyr.camera_ray(offset), limits).is_hit ? 0 : 1;
+                    cells_visited.push_back(counting.lookups);
+                }
+            }
+
+            std::ranges::sort(cells_visited);
+            const auto percentile = [&](const double p) {
+                return cells_visited[static_cast<std::size_t>(p * static_cast<double>(cells_visited.size() - 1))];
+            };
+            char far_plane[16] = "-";
+            char max_steps[16] = "-";
+            if (limits.max_distance != ray_limits{}.max_distance)
+                std::snprintf(far_plane, sizeof(far_plane), "%.0f", limits.max_distance);
+            if (limits.max_steps != ray_limits{}.max_steps)
+                std::snprintf(max_steps, sizeof(max_steps), "%d", limits.max_steps);
+
+            std::printf("%-12s %10s %10s %10.4f %8zu %8zu %8zu %8zu %10zu\n", name, far_plane, max_steps, milliseconds,
+                        percentile(0.5), percentile(0.9), percentile(0.99), cells_visited.back(), misses);
+        };
+
+        const auto field_center = vec2f{field_size / 2 + 0.5f, field_size / 2 + 0.5f};
+        run("maze", maze_map{}, player{}.pos(), ray_limits{});
+        run("maze", maze_map{}, player{}.pos(), ray_limits{.max_distance = 8.0f});
+        run("closed field", closed_field, field_center, ray_limits{});
+        run("closed field", closed_field, field_center, ray_limits{.max_distance = 32.0f});
+        run("closed field", closed_field, field_center, ray_limits{.max_distance = 32.0f, .max_steps = 32});
+        run("open field", open_map{open_field}, field_center, ray_limits{.max_distance = 32.0f});
+    }
+
+    //  Build the lookup table of the maze, save and load it and compare its wall hits and the time it takes to
+    // compute them with casting a ray for every column along the camera path
+    void benchmark_wall_hit_table(const std::vector<player>& path, const int width)
+    {
+        const auto maze = maze_map{};
+        const auto elapsed_since = [](const auto start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        const auto table = wall_hit_table(maze);
+        const auto build_ms = elapsed_since(start);
+
+        const auto* const cache_path = "wsterm_bench_table.bin";
+        start = std::chrono::steady_clock::now();
+        const auto is_saved = table.save(cache_path);
+        const auto save_ms = elapsed_since(start);
+        start = std::chrono::steady_clock::now();
+        const auto is_loaded = wall_hit_table::load(cache_path, maze).has_value();
+        const auto load_ms = elapsed_since(start);
+        std::remove(cache_path);
+
+        std::printf("memory %.1f MB, build %.1f ms (%u threads), save %.1f ms%s, load %.1f ms%s\n",
+                    static_cast<double>(table.memory_footprint()) / (1024.0 * 1024.0), build_ms,
+                    std::max(1u, std::thread::hardware_concurrency()), save_ms, is_saved ? "" : " (failed)", load_ms,
+                    is_loaded ? "" : " (failed)");
+
+        // the error of the wall distance relative to the exact distance over all columns of the camera path
+        const auto screen = screen_buffers({width, 1});
+        auto exact = std::vector<wall_hit>(screen.ray_offsets.size());
+        auto looked_up = std::vector<wall_hit>(screen.ray_offsets.size());
+        auto fallbacks = std::size_t{0};
+        auto mismatches = std::size_t{0};
+        auto max_error = 0.0;
+        for (const auto& plyr : path)
+        {
+            const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(screen.ray_offsets[i]); };
+            compute_wall_hits(maze, std::span(exact), plyr.pos(), ray_dir, 1);
+            fallbacks += table.compute_wall_hits(maze, std::span(looked_up), plyr.view(), screen.ray_offsets).rays_cast;
+            for (std::size_t i = 0; i < exact.size(); ++i)
+            {
+                const auto error = std::abs(static_cast<double>(looked_up[i].distance - exact[i].distance)) /
+                                   static_cast<double>(exact[i].distance);
+                mismatches += (error > 0.0) ? 1 : 0;
+                max_error = std::max(max_error, error);
+            }
+        }
+
+        const auto num_columns = static_cast<double>(std::max<std::size_t>(1, path.size() * exact.size()));
+        std::printf("fallbacks %.2f%%, mismatches %.3f%%, max relative error %.4f\n",
+                    100.0 * static_cast<double>(fallbacks) / num_columns,
+                    100.0 * static_cast<double>(expect_zero(mismatches)) / num_columns, max_error);
+
+        const auto cast_every_column = [&](const std::span<wall_hit> hits, const player& plyr,
+                                           const std::span<const float> ray_offsets, frame_arena&) {
+            const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(ray_offsets[i]); };
+            return compute_wall_hits(maze, hits, plyr.pos(), ray_dir, 1);
+        };
+        const auto look_up = [&](const std::span<wall_hit> hits, const player& plyr,
+                                 const std::span<const float> ray_offsets, frame_arena&) {
+            return table.compute_wall_hits(maze, hits, plyr.view(), ray_offsets);
+        };
+        const auto dda_ms = milliseconds_per_frame(path, width, cast_every_column);
+        const auto span_ms = milliseconds_per_frame(path, width, span_coherence(maze));
+        const auto table_ms = milliseconds_per_frame(path, width, look_up);
+        std::printf("dda %.4f ms, span %.4f ms, table %.4f ms per frame (%.2fx dda, %.2fx span)\n", dda_ms, span_ms,
+                    table_ms, dda_ms / table_ms, span_ms / table_ms);
+    }
+
+    // Any map with its type hidden, so that the DDA can't use a specialization for it (see cast_ray)
+    template <typename Map>
+    struct generic_map
+    {
+        const Map& map;
+
+        [[nodiscard]] bool is_wall(const vec2i& pos) const { return map.is_wall(pos); }
+        [[nodiscard]] int width() const { return map.width(); }
+        [[nodiscard]] int height() const { return map.height(); }
+    };
+
+    //  Compare the memory layouts of maps on huge maps with big rooms: a grid (row by row) with a tiled map
+    // (8x8 tiles with one bit per cell in Morton order) with and without the tile walking DDA, looking along x,
+    // along y or diagonally (rays along y jump a whole row of the grid with every step). Each frame is rendered
+    // from a different random position. Then the same is done for incoherent rays (every ray from a random
+    // position in a random direction within 0.3 radians of the view), which is where the layout matters most
+    // because no ray finds the cache lines of the previous one. Cache and TLB misses are only reported where
+    // hardware counters are available.
+    void benchmark_map_layouts(const int width)
+    {
+        std::printf("%-7s %-9s %-14s %10s %10s %12s %12s %12s %12s\n", "size", "view", "layout", "MB", "frame ms",
+                    "LLC miss/ray", "TLB miss/ray", "random ns", "LLC miss/ray");
+
+#if defined(__linux__)
+        auto cache_misses = perf_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        constexpr auto dtlb_read_misses =
+            PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        auto tlb_misses = perf_counter(PERF_TYPE_HW_CACHE, dtlb_read_misses);
+#else
+        auto cache_misses = perf_counter(0, 0);
+        auto tlb_misses = perf_counter(0, 0);
+#endif
+
+        for (const auto size : {10240, 16384})
+        {
+            const auto grid = generate_map(size, size, 256);
+            const auto tiled = tiled_map(grid);
+
+            auto rng = std::mt19937(7);
+            auto positions = std::vector<vec2f>{};
+            while (positions.size() < 200)
+            {
+                const auto x = std::uniform_int_distribution(1, size - 2)(rng);
+                const auto y = std::uniform_int_distribution(1, size - 2)(rng);
+                if (!grid.is_wall(vec2i{x, y}))
+                    positions.push_back({static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f});
+            }
+
+            const auto screen = screen_buffers({width, 1});
+            auto hits = std::vector<wall_hit>(screen.ray_offsets.size());
+
+            // the random rays of the incoherent benchmark, relative to the view direction
+            auto random_rays = std::vector<std::pair<vec2f, float>>{};
+            while (random_rays.size() < 100'000)
+            {
+                const auto x = std::uniform_int_distribution(1, size - 2)(rng);
+                const auto y = std::uniform_int_distribution(1, size - 2)(rng);
+                if (!grid.is_wall(vec2i{x, y}))
+                    random_rays.emplace_back(vec2f{static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f},
+                                             std::uniform_real_distribution(-0.3f, 0.3f)(rng));
+            }
+
+            // misses per ray as text ("-" if the counter is not available)
+            const auto per_ray = [](const perf_counter& counter, const std::uint64_t count, const double num_rays) {
+                auto text = std::array<char, 16>{'-'};
+                if (counter.is_valid())
+                    std::snprintf(text.data(), text.size(), "%.2f", static_cast<double>(count) / num_rays);
+                return text;
+            };
+
+            const auto run = [&](const char* view, const char* layout, const double megabytes, const auto& map,
+                                 const vec2f& forward) {
+                const auto right = vec2f{forward.y, -forward.x} * 0.8f;
+                const auto num_frame_rays = static_cast<double>(positions.size() * hits.size());
+
+                cache_misses.start();
+                tlb_misses.start();
+                auto start = std::chrono::steady_clock::now();
+                for (const auto& pos : positions)
+                {
+                    const auto ray_dir = [&](const std::size_t i) { return forward + right * screen.ray_offsets[i]; };
+                    compute_wall_hits(map, std::span(hits), pos, ray_dir, 1);
+                }
+                using milliseconds = std::chrono::duration<double, std::milli>;
+                const auto frame_time = milliseconds(std::chrono::steady_clock::now() - start);
+                const auto frame_cache_misses = per_ray(cache_misses, cache_misses.stop(), num_frame_rays);
+                const auto frame_tlb_misses = per_ray(tlb_misses, tlb_misses.stop(), num_frame_rays);
+
+                auto distance_sum = 0.0f;  // keeps the rays from being optimized away
+                cache_misses.start();
+                start = std::chrono::steady_clock::now();
+                for (const auto& [pos, angle] : random_rays)
+                    distance_sum += compute_wall_hit(map, pos, rotate(forward, angle)).distance;
+                using nanoseconds = std::chrono::duration<double, std::nano>;
+                const auto ray_time = nanoseconds(std::chrono::steady_clock::now() - start);
+                const auto num_random_rays = static_cast<double>(random_rays.size());
+                const auto ray_cache_misses = per_ray(cache_misses, cache_misses.stop(), num_random_rays);
+
+                std::printf("%-7d %-9s %-14s %10.1f %10.4f %12s %12s %12.1f %12s%s\n", size, view, layout, megabytes,
+                            frame_time.count() / static_cast<double>(positions.size()), frame_cache_misses.data(),
+                            frame_tlb_misses.data(), ray_time.count() / num_random_rays, ray_cache_misses.data(),
+                            (distance_sum < 0.0f) ? "?" : "");
+            };
+
+            const auto grid_megabytes = static_cast<double>(size) * size / (1024.0 * 1024.0);
+            const auto tiled_megabytes = static_cast<double>(tiled.memory_footprint()) / (1024.0 * 1024.0);
+            const auto diagonal = vec2f{0.7071f, 0.7071f};
+            for (const auto& [view, forward] : {std::pair("along x", vec2f{1.0f, 0.0f}),
+                                                std::pair("along y", vec2f{0.0f, 1.0f}),
+                                                std::pair("diagonal", diagonal)})
+            {
+                run(view, "grid", grid_megabytes, grid, forward);
+                run(view, "tiled", tiled_megabytes, generic_map{tiled}, forward);
+                run(view, "tiled walk", tiled_megabytes, tiled, forward);
+            }
+        }
+    }
+
+    //  The ways the DDA can take its steps (see dda_stepping) for rays at a range of angles to the x-axis, cast
+    // from random positions in a field with pillars: the time per ray, the branch misses per ray (if hardware
+    // counters are available) and the number of rays that hit a different face than with branching.
+    void benchmark_dda_stepping()
+    {
+        std::printf("%-8s %-10s %10s %10s %14s %10s\n", "angle", "stepping", "cells/ray", "ns/ray", "br miss/ray",
+                    "mismatches");
+
+#if defined(__linux__)
+        auto branch_misses = perf_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#else
+        auto branch_misses = perf_counter(0, 0);
+#endif
+
+        constexpr auto field_size = 1024;
+        const auto field = generate_map(field_size, field_size, field_size);
+        auto rng = std::mt19937(11);
+        auto positions = std::vector<vec2f>{};
+        while (positions.size() < 100'000)
+        {
+            const auto x = std::uniform_real_distribution(1.0f, field_size - 1.0f)(rng);
+            const auto y = std::uniform_real_distribution(1.0f, field_size - 1.0f)(rng);
+            if (!field.is_wall(vec2i{static_cast<int>(x), static_cast<int>(y)})) positions.push_back({x, y});
+        }
+
+        auto faces = std::vector<wall_face>(positions.size());
+        auto expected = std::vector<wall_face>(positions.size());
+        for (const auto degrees : {0.5f, 5.0f, 15.0f, 30.0f, 45.0f})
+        {
+            const auto dir = rotate(vec2f{1.0f, 0.0f}, degrees * std::numbers::pi_v<float> / 180.0f);
+            auto cells_visited = std::size_t{0};
+            for (const auto stepping : {dda_stepping::branch, dda_stepping::select, dda_stepping::unrolled})
+            {
+                const auto options = ray_options{.stepping = stepping};
+                branch_misses.start();
+                const auto start = std::chrono::steady_clock::now();
+                for (std::size_t i = 0; i < positions.size(); ++i)
+                    faces[i] = find_wall_face(field, positions[i], dir, {}, options);
+                const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+                const auto misses = branch_misses.stop();
+
+                // every step visits a cell, either to the side or up/down
+                if (stepping == dda_stepping::branch)
+                {
+                    expected = faces;
+                    cells_visited = 0;
+                    for (std::size_t i = 0; i < faces.size(); ++i)
+                        cells_visited += static_cast<std::size_t>(
+                            std::abs(faces[i].cell.x - static_cast<int>(positions[i].x)) +
+                            std::abs(faces[i].cell.y - static_cast<int>(positions[i].y)) + 1);
+                }
+
+                auto mismatches = std::size_t{0};
+                for (std::size_t i = 0; i < faces.size(); ++i)
+                    mismatches += (faces[i] != expected[i]) ? 1 : 0;
+
+                const auto num_rays = static_cast<double>(positions.size());
+                auto misses_per_ray = std::array<char, 16>{'-'};
+                if (branch_misses.is_valid())
+                    std::snprintf(misses_per_ray.data(), misses_per_ray.size(), "%.2f",
+                                  static_cast<double>(misses) / num_rays);
+
+                std::printf("%-8.1f %-10s %10.1f %10.1f %14s %10zu\n", degrees, dda_stepping_name(stepping).data(),
+                            static_cast<double>(cells_visited) / num_rays, elapsed.count() / num_rays,
+                            misses_per_ray.data(), expect_zero(mismatches));
+            }
+        }
+    }
+
+    // An endless map of closed rooms (16 cells apart) for casting rays arbitrarily far from the origin
+    struct room_lattice
+    {
+        static constexpr int room_size = 16;
+
+        [[nodiscard]] constexpr bool is_wall(const vec2i& pos) const
+        {
+            return (pos.x % room_size == 0) or (pos.y % room_size == 0);
+        }
+    };
+
+    //  The raycaster with each scalar type (see scalar_traits) at increasing distances from the origin: the time
+    // per ray and how far the wall hits are off compared to casting the same rays close to the origin in double
+    // precision (the map repeats, so those rays hit the same walls): the mean and maximum error of the texture
+    // coordinate (in texels of a 64 texel texture), the maximum relative error of the distance and the fraction
+    // of rays that hit the wrong face. Fixed point numbers do not reach the larger distances.
+    void benchmark_scalar_types()
+    {
+        std::printf("%-8s %10s %10s %12s %12s %12s %10s\n", "scalar", "offset", "ns/ray", "mean texels",
+                    "max texels", "distance", "wrong face");
+
+        const auto map = room_lattice{};
+        constexpr auto num_rays = 100'000;
+        auto rng = std::mt19937(13);
+        auto rays = std::vector<std::pair<vec2d, vec2d>>{};
+        for (int i = 0; i < num_rays; ++i)
+        {
+            // positions on a grid of 1/64 cells (exactly representable in every scalar type)
+            const auto local = [&] { return std::uniform_int_distribution(64, 15 * 64 - 1)(rng) / 64.0; };
+            const auto angle = std::uniform_real_distribution(0.0, 2.0 * std::numbers::pi)(rng);
+            rays.emplace_back(vec2d{local(), local()}, vec2d{std::cos(angle), std::sin(angle)});
+        }
+
+        auto expected = std::vector<std::pair<wall_face, wall_hit>>{};
+        for (const auto& [pos, dir] : rays)
+        {
+            const auto face = find_wall_face(map, pos, dir);
+            expected.emplace_back(face, intersect_wall_face(pos, dir, face));
+        }
+
+        const auto run = [&]<typename T>(const char* name, const int offset) {
+            if (static_cast<double>(offset) + room_lattice::room_size >=
+                static_cast<double>(scalar_traits<T>::infinity()))
+            {
+                std::printf("%-8s %10d %10s %12s %12s %12s %10s\n", name, offset, "-", "-", "-", "-", "-");
+                return;
+            }
+
+            auto casts = std::vector<std::pair<vec2<T>, vec2<T>>>{};
+            for (const auto& [pos, dir] : rays)
+                casts.emplace_back(vec2<T>{T(pos.x + offset), T(pos.y + offset)}, vec2_cast<T>(dir));
+
+            auto faces = std::vector<wall_face>(casts.size());
+            auto hits = std::vector<wall_hit>(casts.size());
+            const auto start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < casts.size(); ++i)
+            {
+                faces[i] = find_wall_face(map, casts[i].first, casts[i].second);
+                hits[i] = intersect_wall_face(casts[i].first, casts[i].second, faces[i]);
+            }
+            const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+
+            auto texel_error_sum = 0.0;
+            auto max_texel_error = 0.0;
+            auto max_distance_error = 0.0;
+            auto wrong_faces = 0;
+            for (std::size_t i = 0; i < casts.size(); ++i)
+            {
+                const auto& [expected_face, expected_hit] = expected[i];
+                const auto face = wall_face{faces[i].cell - vec2i{offset, offset}, faces[i].is_x};
+                if (face != expected_face)
+                {
+                    ++wrong_faces;
+                    continue;
+                }
+
+                // texture coordinates wrap around
+                const auto tx_error = std::abs(static_cast<double>(hits[i].tx) - expected_hit.tx);
+                const auto texel_error = 64.0 * std::min(tx_error, 1.0 - tx_error);
+                texel_error_sum += texel_error;
+                max_texel_error = std::max(max_texel_error, texel_error);
+                max_distance_error = std::max(max_distance_error,
+                                              std::abs(hits[i].distance / expected_hit.distance - 1.0));
+            }
+
+            const auto num_right_faces = std::max(1.0, static_cast<double>(num_rays - wrong_faces));
+            std::printf("%-8s %10d %10.1f %12.4f %12.4f %12.2e %9.2f%%\n", name, offset, elapsed.count() / num_rays,
+                        texel_error_sum / num_right_faces, max_texel_error, max_distance_error,
+                        100.0 * wrong_faces / num_rays);
+        };
+
+        for (const auto offset : {0, 1'024, 16'384, 1'048'576, 16'777'216})
+        {
+            run.operator()<float>("float", offset);
+            run.operator()<double>("double", offset);
+            run.operator()<fixed>("fixed", offset);
+        }
+    }
+
+    //  The fast approximations of fast_math against libm (and division): the maximum error of both compared to
+    // double precision libm and the time per element for a buffer of arguments (where the fast versions are
+    // vectorized). Then the effect on the raycaster: the time per frame with the fast reciprocal for the ray
+    // step distances and the number of columns that end up with a different wall hit.
+    void benchmark_fast_math(const std::vector<player>& path, const int width)
+    {
+        std::printf("%-12s %-10s %12s %12s %12s %12s\n", "function", "range", "fast error", "libm error", "fast ns",
+                    "libm ns");
+
+        constexpr auto n = std::size_t{1} << 16;
+        auto rng = std::mt19937(17);
+        const auto random_floats = [&](const float min, const float max) {
+            auto values = std::vector<float>(n);
+            for (auto& v : values)
+                v = std::uniform_real_distribution(min, max)(rng);
+            return values;
+        };
+
+        auto out = std::vector<float>(n);
+        auto out2 = std::vector<float>(n);
+
+        // the average time per element of f computing a buffer of results (repeatedly). The barrier tells
+        // the compiler that the results are used, so that it cannot drop them.
+        const auto nanoseconds_per_element = [&](const auto& f) {
+            constexpr auto repetitions = 20;
+            const auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repetitions; ++r)
+            {
+                f();
+#if defined(__GNUC__)
+                asm volatile("" : : "r"(out.data()), "r"(out2.data()) : "memory");
+#endif
+            }
+            const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+            return elapsed.count() / static_cast<double>(repetitions * n);
+        };
+
+        const auto max_error = [&](const auto& error) {
+            auto result = 0.0;
+            for (std::size_t i = 0; i < n; ++i)
+                result = std::max(result, error(i));
+            return result;
+        };
+
+        const auto angles = random_floats(-1000.0f, 1000.0f);
+        const auto sincos_error = [&](const auto& sincos) {
+            return max_error([&](const std::size_t i) {
+                const auto [s, c] = sincos(angles[i]);
+                const auto x = static_cast<double>(angles[i]);
+                return std::max(std::abs(s - std::sin(x)), std::abs(c - std::cos(x)));
+            });
+        };
+        std::printf("%-12s %-10s %12.2e %12.2e %12.2f %12.2f\n", "sincos", "+-1000",
+                    sincos_error([](const float x) { return fast_math::sincos(x); }),
+                    sincos_error([](const float x) { return fast_math::sincos_result{std::sin(x), std::cos(x)}; }),
+                    nanoseconds_per_element([&] { fast_math::sincos(angles, out, out2); }),
+                    nanoseconds_per_element([&] {
+                        for (std::size_t i = 0; i < n; ++i)
+                        {
+                            out[i] = std::sin(angles[i]);
+                            out2[i] = std::cos(angles[i]);
+                        }
+                    }));
+
+        const auto xs = random_floats(-10.0f, 10.0f);
+        const auto ys = random_floats(-10.0f, 10.0f);
+        const auto atan2_error = [&](const auto& atan2) {
+            return max_error([&](const std::size_t i) {
+                const auto expected = std::atan2(static_cast<double>(ys[i]), static_cast<double>(xs[i]));
+                return std::abs(atan2(ys[i], xs[i]) - expected);
+            });
+        };
+        std::printf("%-12s %-10s %12.2e %12.2e %12.2f %12.2f\n", "atan2", "+-10",
+                    atan2_error([](const float y, const float x) { return fast_math::atan2(y, x); }),
+                    atan2_error([](const float y, const float x) { return std::atan2(y, x); }),
+                    nanoseconds_per_element([&] { fast_math::atan2(ys, xs, out); }),
+                    nanoseconds_per_element([&] {
+                        for (std::size_t i = 0; i < n; ++i)
+                            out[i] = std::atan2(ys[i], xs[i]);
+                    }));
+
+        // relative error, with arguments like the components of ray directions
+        const auto reciprocal_error = [&](const auto& reciprocal) {
+            return max_error([&](const std::size_t i) {
+                return std::abs(reciprocal(xs[i]) * static_cast<double>(xs[i]) - 1.0);
+            });
+        };
+        std::printf("%-12s %-10s %12.2e %12.2e %12.2f %12.2f\n", "reciprocal", "+-10",
+                    reciprocal_error([](const float x) { return fast_math::reciprocal(x); }),
+                    reciprocal_error([](const float x) { return 1.0f / x; }),
+                    nanoseconds_per_element([&] { fast_math::reciprocal(xs, out); }),
+                    nanoseconds_per_element([&] {
+                        for (std::size_t i = 0; i < n; ++i)
+                            out[i] = 1.0f / xs[i];
+                    }));
+
+        const auto cast_every_column = [](const ray_options& options) {
+            return [options](const std::span<wall_hit> hits, const player& plyr,
+                             const std::span<const float> ray_offsets, frame_arena&) {
+                const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(ray_offsets[i]); };
+                return compute_wall_hits(maze_map{}, hits, plyr.pos(), ray_dir, 1, 1, {}, options);
+            };
+        };
+        const auto fast = ray_options{.is_fast_math = true};
+        std::printf("\nrays in the maze: %.4f ms per frame with division, %.4f ms with the fast reciprocal, "
+                    "%zu columns differ\n",
+                    milliseconds_per_frame(path, width, cast_every_column({})),
+                    milliseconds_per_frame(path, width, cast_every_column(fast)),
+                    count_mismatches(maze_map{}, path, width, cast_every_column(fast)));
+
+        // a player turning (by varying amounts) with the fast trigonometry drifts away from one that turns
+        // with libm
+        auto libm_player = player{};
+        auto fast_player = basic_player<float, fast_math::traits>{};
+        auto max_drift = 0.0f;
+        for (std::size_t i = 0; i < path.size(); ++i)
+        {
+            const auto factor = static_cast<float>(i % 7 + 1) * 0.3f;
+            libm_player.turn(factor, 1.0f / 60.0f);
+            fast_player.turn(factor, 1.0f / 60.0f);
+            const auto drift = libm_player.camera_ray(0.0f) - fast_player.camera_ray(0.0f);
+            max_drift = std::max({max_drift, std::abs(drift.x), std::abs(drift.y)});
+        }
+        std::printf("turning for %zu frames: the view directions differ by at most %.2e\n", path.size(), max_drift);
+    }
+
+    // The maze looked up in its string literal for every cell, like before it was baked at compile time
+    struct literal_maze
+    {
+        [[nodiscard]] bool is_wall(const vec2i& pos) const { return maze[pos.y][pos.x] == L'+'; }
+        [[nodiscard]] int width() const { return row_length(maze[0]); }
+        [[nodiscard]] int height() const { return maze_height; }
+    };
+
+    //  Cast every ray in the maze baked at compile time (see bake_map) and in the maze looked up in its string
+    // literal, and check the baked distance field against a brute force search for the closest wall.
+    void benchmark_baked_map(const std::vector<player>& path, const int width)
+    {
+        const auto cast_every_column = [](const auto& map) {
+            return [&map](const std::span<wall_hit> hits, const player& plyr, const std::span<const float> ray_offsets,
+                          frame_arena&) {
+                const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(ray_offsets[i]); };
+                return compute_wall_hits(map, hits, plyr.pos(), ray_dir, 1);
+            };
+        };
+        const auto literal = literal_maze{};
+        const auto baked = maze_map{};
+        std::printf("literal %.4f ms, baked %.4f ms per frame, %zu columns differ\n",
+                    milliseconds_per_frame(path, width, cast_every_column(literal)),
+                    milliseconds_per_frame(path, width, cast_every_column(baked)),
+                    expect_zero(count_mismatches(baked, path, width, cast_every_column(literal))));
+
+        auto wrong_distances = std::size_t{0};
+        auto max_distance = 0;
+        for (int y = 0; y < baked.height(); ++y)
+        {
+            for (int x = 0; x < baked.width(); ++x)
+            {
+                auto closest = std::numeric_limits<int>::max();
+                for (int wall_y = 0; wall_y < baked.height(); ++wall_y)
+                    for (int wall_x = 0; wall_x < baked.width(); ++wall_x)
+                        if (literal.is_wall({wall_x, wall_y}))
+                            closest = std::min(closest, std::max(std::abs(wall_x - x), std::abs(wall_y - y)));
+
+                wrong_distances += (baked.distance({x, y}) == closest) ? 0 : 1;
+                max_distance = std::max(max_distance, closest);
+            }
+        }
+        std::printf("distance field: %zu wrong cells, the largest distance to a wall is %d\n",
+                    expect_zero(wrong_distances), max_distance);
+    }
+
+    // Draw a column with the rendering mode as a runtime flag that is checked over and over, like before the
+    // modes were policy types (see draw_column)
+    void draw_column_with_flags(framebuffer& frame, const int x, const wall_hit hit, bool is_blocky, const float fog)
+    {
+        const auto is_fogged = fog > 0.0f;
+        is_blocky = is_blocky or is_fogged;
+
+        const auto screen_height = frame.height();
+        const auto exact_wall_height = static_cast<float>(screen_height) / hit.distance;
+        const auto truncated_wall_height = static_cast<int>(exact_wall_height);
+        const auto num_whole_chars = truncated_wall_height - (is_blocky ? 0 : (truncated_wall_height % 2));
+        const auto wall_top = ((screen_height - num_whole_chars) / 2) - 1;
+        const auto wall_bottom = wall_top + num_whole_chars + 2;
+        const auto wall_start = wall_top + (is_blocky ? 0 : 1);
+        const auto floor_start = wall_bottom + (is_blocky ? 0 : 1);
+        const auto wall_char = is_fogged ? fog_glyph(fog) : ((hit.tx < 0.1f) or (hit.tx > 0.9)) ? U'\u2502' : U' ';
+
+        const auto block_between = [&](int min, int max) {
+            min = std::max(0, min);
+            max = std::min(screen_height, max);
+            return std::ranges::iota_view(std::min(min, max), max);
+        };
+        const auto print = [&](const char32_t c, const bool invert = false) {
+            const auto attributes = invert ? attribute::reversed : attribute::none;
+            return [&, c, attributes](const int y) { frame.put(x, y, c, attributes); };
+        };
+
+        std::ranges::for_each(block_between(0, wall_top), print(U' '));
+        std::ranges::for_each(block_between(wall_start, wall_bottom), print(wall_char, !is_fogged));
+        std::ranges::for_each(block_between(floor_start, screen_height), print(U'.'));
+        if (!is_blocky and (wall_top >= 0))
+        {
+            const auto fraction = 0.5f * (exact_wall_height - static_cast<float>(num_whole_chars));
+            print(fractional_block(fraction))(wall_top);
+            print(fractional_block(1.0f - fraction), true)(wall_bottom);
+        }
+    }
+
+    //  Draw cell column x in braille like draw_braille_column, but dot by dot: every dot of every cell is
+    // checked against the wall and the floor of its column of dots and set on its own
+    void draw_braille_column_per_dot(framebuffer& frame, const int x, const std::array<wall_hit, 2>& hits,
+                                     const std::array<float, 2>& fog)
+    {
+        constexpr auto dots =
+            std::array<std::array<std::uint8_t, 4>, 2>{{{0x01, 0x02, 0x04, 0x40}, {0x08, 0x10, 0x20, 0x80}}};
+        const auto dot_rows = 4 * frame.height();
+        const auto columns = std::array{braille::column_of(hits[0], dot_rows, fog[0], 0),
+                                        braille::column_of(hits[1], dot_rows, fog[1], 1)};
+
+        for (int y = 0; y < frame.height(); ++y)
+        {
+            auto bits = 0u;
+            for (std::size_t side = 0; side < 2; ++side)
+            {
+                const auto& column = columns[side];
+                for (int row = 0; row < 4; ++row)
+                {
+                    const auto dot_row = 4 * y + row;
+                    const auto is_wall = (dot_row >= column.wall_begin) and (dot_row < column.wall_end) and
+                                         (((column.wall_dots >> row) & 1u) != 0);
+                    const auto is_floor = (side == 0) and (row == 3) and (dot_row >= column.wall_end);
+                    if (is_wall or is_floor) bits |= dots[side][static_cast<std::size_t>(row)];
+                }
+            }
+            frame.put(x, y, (bits == 0) ? U' ' : static_cast<char32_t>(0x2800 + bits));
+        }
+    }
+
+    //  Draw the columns for the wall hits along the path in every rendering mode, with and without a far plane
+    // (i.e. fog), once with the mode as a policy type (see draw_walls) and, for the modes that there was a flag
+    // for (smooth and blocky), once with the mode as a runtime flag. Only drawing is timed (the wall hits are
+    // computed up front) and both must draw exactly the same frames. Braille casts two rays per column and sets 8
+    // dots per cell; it is compared with setting the dots one by one (see draw_braille_column_per_dot).
+    void benchmark_render_modes(const std::vector<player>& path, const std::pair<int, int>& screen_size)
+    {
+        const auto [width, height] = screen_size;
+        const auto screen = screen_buffers({width, 1});
+        const auto cell_hits = wall_hits_along_path(path, screen.ray_offsets);
+        const auto braille_hits = wall_hits_along_path(path, screen.braille_ray_offsets);
+
+        std::printf("%-8s %10s %12s %12s %12s %10s\n", "mode", "far plane", "policy ms", "flags ms", "Mcells/s",
+                    "mismatches");
+
+        const auto run = [&](const render_mode mode, const ray_limits& limits) {
+            const auto settings = render_settings{.mode = mode, .limits = limits};
+            const auto& frame_hits = (mode == render_mode::braille) ? braille_hits : cell_hits;
+            auto policy_frame = framebuffer(width, height);
+            auto flags_frame = framebuffer(width, height);
+
+            const auto draw_with_policy = [&](const std::vector<wall_hit>& hits) {
+                visit_render_mode(mode, [&]<typename Mode>(Mode) { draw_walls<Mode>(policy_frame, hits, settings); });
+            };
+            const auto draw_with_flags = [&](const std::vector<wall_hit>& hits) {
+                const auto fog_wall = wall_hit{.distance = fog_distance(limits), .tx = 0.5f};
+                if (mode == render_mode::braille)
+                {
+                    for (int i = 0; i < width; ++i)
+                    {
+                        auto column_hits = std::array{hits[2 * i], hits[2 * i + 1]};
+                        auto fog = std::array{0.0f, 0.0f};
+                        for (std::size_t side = 0; limits.is_bounded() and (side < 2); ++side)
+                        {
+                            fog[side] = fog_amount(column_hits[side].distance, limits, settings.fog_start);
+                            if (fog[side] >= 1.0f) column_hits[side] = fog_wall;
+                        }
+                        draw_braille_column_per_dot(flags_frame, i, column_hits, fog);
+                    }
+                    return;
+                }
+                for (int i = 0; i < width; ++i)
+                {
+                    const auto fog = fog_amount(hits[i].distance, limits, settings.fog_start);
+                    draw_column_with_flags(flags_frame, i, (fog < 1.0f) ? hits[i] : fog_wall,
+                                           mode == render_mode::blocky, fog);
+                }
+            };
+            char far_plane[16] = "-";
+            if (limits.is_bounded()) std::snprintf(far_plane, sizeof(far_plane), "%.0f", limits.max_distance);
+            const auto policy_ms = milliseconds_per_frame(frame_hits, draw_with_policy);
+            std::printf("%-8s %10s %12.4f ", render_mode_name(mode).data(), far_plane, policy_ms);
+            if (mode == render_mode::shaded)
+            {
+                std::printf("%12s %12.1f %10s\n", "-", width * height / policy_ms / 1000.0, "-");
+                return;
+            }
+
+            auto mismatches = std::size_t{0};
+            for (const auto& hits : frame_hits)
+            {
+                draw_with_policy(hits);
+                draw_with_flags(hits);
+                for (int y = 0; y < height; ++y)
+                    mismatches += std::ranges::equal(policy_frame.row(y), flags_frame.row(y)) ? 0 : 1;
+            }
+            std::printf("%12.4f %12.1f %10zu\n", milliseconds_per_frame(frame_hits, draw_with_flags),
+                        width * height / policy_ms / 1000.0, expect_zero(mismatches));
+        };
+
+        for (const auto mode : {render_mode::smooth, render_mode::blocky, render_mode::braille, render_mode::shaded})
+        {
+            run(mode, ray_limits{});
+            run(mode, ray_limits{.max_distance = 6.0f});
+        }
+    }
+
+    //  The cost of shading on the terminal: the encoded bytes and the style (attribute or color) changes, each of
+    // which is an escape sequence, per frame for whole frames (e.g. after a resize) and for the changes between
+    // frames along the path, in the monochrome modes and with shading
+    void benchmark_shading(const std::vector<player>& path, const std::pair<int, int>& screen_size)
+    {
+        std::printf("%-8s %12s %12s %12s %12s\n", "mode", "full bytes", "full changes", "delta bytes",
+                    "delta changes");
+        for (const auto mode : {render_mode::smooth, render_mode::blocky, render_mode::shaded})
+        {
+            auto screen = screen_buffers(screen_size);
+            auto arena = frame_arena{};
+            const auto settings = render_settings{.mode = mode};
+            auto full = encoded_frame{};
+            auto delta = encoded_frame{};
+            for (const auto& plyr : path)
+            {
+                arena.reset();
+                render(screen, plyr, settings, arena);
+                const auto full_frame = encode_changes(screen.frame, framebuffer{}, arena);
+                const auto changes = encode_changes(screen.frame, screen.presented, arena);
+                std::swap(screen.frame, screen.presented);
+                full.bytes += full_frame.bytes;
+                full.style_changes += full_frame.style_changes;
+                delta.bytes += changes.bytes;
+                delta.style_changes += changes.style_changes;
+            }
+
+            const auto per_frame = [&](const std::size_t n) {
+                return static_cast<double>(n) / static_cast<double>(std::max<std::size_t>(1, path.size()));
+            };
+            std::printf("%-8s %12.0f %12.1f %12.0f %12.1f\n", render_mode_name(mode).data(), per_frame(full.bytes),
+                        per_frame(full.style_changes), per_frame(delta.bytes), per_frame(delta.style_changes));
+        }
+    }
+
+    //  The frame breakdown with post-processing (see dither_walls): the time spent on drawing the scene and on
+    // the post-processing pass per frame along the path (as measured by render) in the modes that it applies to
+    void benchmark_post_processing(const std::vector<player>& path, const std::pair<int, int>& screen_size)
+    {
+        std::printf("%-8s %10s %12s %12s %12s\n", "mode", "dithered", "scene ms", "post ms", "Mcells/s");
+        for (const auto mode : {render_mode::smooth, render_mode::blocky, render_mode::shaded})
+        {
+            for (const auto is_dithered : {false, true})
+            {
+                auto screen = screen_buffers(screen_size);
+                auto arena = frame_arena{};
+                const auto settings = render_settings{.mode = mode, .is_dithered = is_dithered};
+                auto scene_ms = 0.0;
+                auto post_process_ms = 0.0;
+                for (const auto& plyr : path)
+                {
+                    arena.reset();
+                    const auto stats = render(screen, plyr, settings, arena);
+                    scene_ms += stats.scene_time.count();
+                    post_process_ms += stats.post_process_time.count();
+                }
+
+                const auto frames = static_cast<double>(std::max<std::size_t>(1, path.size()));
+                const auto cells = static_cast<double>(screen_size.first) * screen_size.second;
+                std::printf("%-8s %10s %12.4f %12.4f ", render_mode_name(mode).data(), is_dithered ? "yes" : "no",
+                            scene_ms / frames, post_process_ms / frames);
+                if (is_dithered)
+                    std::printf("%12.1f\n", cells * frames / post_process_ms / 1000.0);
+                else
+                    std::printf("%12s\n", "-");
+            }
+        }
+    }
+
+    // Draw column x with a textured wall like draw_textured_column, but with a division for the texture row of every
+    // cell instead of stepping through the stripe
+    void draw_textured_column_with_division(framebuffer& frame, const int x, const wall_hit hit,
+                                            const wall_texture& texture)
+    {
+        const auto screen_height = frame.height();
+        const auto exact_wall_height = static_cast<float>(screen_height) / hit.distance;
+        const auto exact_wall_top = 0.5f * (static_cast<float>(screen_height) - exact_wall_height);
+        const auto wall_begin = std::clamp(static_cast<int>(std::ceil(exact_wall_top - 0.5f)), 0, screen_height);
+        const auto wall_end = std::clamp(static_cast<int>(std::ceil(exact_wall_top + exact_wall_height - 0.5f)),
+                                         wall_begin, screen_height);
+
+        frame.fill_column(x, 0, wall_begin, {U' '});
+        frame.fill_column(x, wall_end, screen_height, {U'.'});
+        if (wall_begin == wall_end) return;
+
+        const auto stripe = texture.stripe(texture.level_for(exact_wall_height), hit.tx);
+        const auto rows = static_cast<float>(stripe.size());
+        auto y = wall_begin;
+        frame.generate_column(x, wall_begin, wall_end, [&] {
+            const auto v = (static_cast<float>(y++) + 0.5f - exact_wall_top) / exact_wall_height;
+            return stripe[std::min(static_cast<std::size_t>(std::max(0.0f, v * rows)), stripe.size() - 1)];
+        });
+    }
+
+    //  Textured walls (see draw_textured_column) at growing screen heights: the time to draw the walls of a frame
+    // along the path in the smooth mode, textured (with the texture rows stepped through incrementally) and textured
+    // with a division per cell, the cost of the texture fetches per wall cell (textured against smooth), the cells
+    // where stepping and division pick different texels and the scene time of whole frames (see render)
+    void benchmark_textures(const std::vector<player>& path, const int width)
+    {
+        const auto screen = screen_buffers({width, 1});
+        const auto frame_hits = wall_hits_along_path(path, screen.ray_offsets);
+
+        std::printf("%-8s %12s %12s %12s %12s %12s %10s %12s\n", "height", "wall cells", "smooth ms", "textured ms",
+                    "division ms", "fetch ns", "differ", "scene ms");
+        const auto& texture = builtin_wall_texture();
+        for (const auto height : {60, 250, 1000})
+        {
+            auto frame = framebuffer(width, height);
+            auto divided = framebuffer(width, height);
+            const auto smooth_ms = milliseconds_per_frame(frame_hits, [&](const std::vector<wall_hit>& hits) {
+                draw_walls<smooth_mode>(frame, hits, render_settings{});
+            });
+            const auto textured_ms = milliseconds_per_frame(frame_hits, [&](const std::vector<wall_hit>& hits) {
+                draw_walls<textured_mode>(frame, hits, render_settings{});
+            });
+            const auto division_ms = milliseconds_per_frame(frame_hits, [&](const std::vector<wall_hit>& hits) {
+                for (int i = 0; i < width; ++i)
+                    draw_textured_column_with_division(divided, i, hits[i], texture);
+            });
+
+            auto wall_cells = 0.0;
+            auto differ = std::size_t{0};
+            for (const auto& hits : frame_hits)
+            {
+                draw_walls<textured_mode>(frame, hits, render_settings{});
+                for (int i = 0; i < width; ++i)
+                {
+                    wall_cells += std::min<double>(height, height / hits[i].distance);
+                    draw_textured_column_with_division(divided, i, hits[i], texture);
+                }
+                for (int y = 0; y < height; ++y)
+                    for (int x = 0; x < width; ++x)
+                        differ += (frame.row(y)[x] == divided.row(y)[x]) ? 0 : 1;
+            }
+
+            auto scene = screen_buffers({width, height});
+            auto arena = frame_arena{};
+            const auto settings = render_settings{.mode = render_mode::textured};
+            auto scene_ms = 0.0;
+            for (const auto& plyr : path)
+            {
+                arena.reset();
+                scene_ms += render(scene, plyr, settings, arena).scene_time.count();
+            }
+
+            const auto frames = static_cast<double>(std::max<std::size_t>(1, path.size()));
+            wall_cells /= frames;
+            std::printf("%-8d %12.0f %12.4f %12.4f %12.4f %12.2f %10zu %12.4f\n", height, wall_cells, smooth_ms,
+                        textured_ms, division_ms, (textured_ms - smooth_ms) * 1e6 / std::max(1.0, wall_cells),
+                        differ, scene_ms / frames);
+        }
+    }
+
+    // Cast the floor and the ceiling like cast_floor_and_ceiling, but a column at a time with the distance of every
+    // cell divided out and the point that it shows computed from the ray of its column
+    void cast_floor_and_ceiling_per_column(framebuffer& frame, const camera& cam, const std::span<const float> offsets)
+    {
+        const auto height = frame.height();
+        for (int x = 0; x < frame.width(); ++x)
+        {
+            const auto ray = cam.ray(offsets[static_cast<std::size_t>(x)]);
+            for (int y = 0; y < height; ++y)
+            {
+                const auto below = 2 * y + 1 - height;
+                auto& c = frame.row(y)[static_cast<std::size_t>(x)];
+                const auto empty = (below > 0) ? U'.' : U' ';
+                if ((below == 0) or (c.glyph != empty) or (c.attributes != attribute::none)) continue;
+
+                const auto& texture = (below > 0) ? builtin_floor_texture() : builtin_ceiling_texture();
+                const auto distance = static_cast<float>(height) / static_cast<float>(std::abs(below));
+                const auto across = cam.ray(1.0f) - cam.ray(-1.0f);
+                const auto last = static_cast<float>(std::max(1, frame.width() - 1));
+                const auto level = texture.level_for(last / (distance * std::hypot(across.x, across.y)));
+                const auto [texture_width, texture_height] = texture.level_size(level);
+                const auto p = cam.pos + ray * distance;
+                const auto u = static_cast<int>((p.x - std::floor(p.x)) * static_cast<float>(texture_width));
+                const auto v = static_cast<int>((p.y - std::floor(p.y)) * static_cast<float>(texture_height));
+                const auto index = std::clamp(u, 0, texture_width - 1) * texture_height +
+                                   std::clamp(v, 0, texture_height - 1);
+                c = texture.texels(level)[static_cast<std::size_t>(index)];
+            }
+        }
+    }
+
+    //  Floor and ceiling casting (see cast_floor_and_ceiling) compared with wall casting at growing screen heights:
+    // the time per frame along the path to compute the wall hits, to draw the walls and to cast the floor and the
+    // ceiling row by row and a column at a time, the floor and ceiling cells cast per microsecond and the cells
+    // where the two ways of casting pick different texels
+    void benchmark_floor_casting(const std::vector<player>& path, const int width)
+    {
+        const auto screen = screen_buffers({width, 1});
+        auto arena = frame_arena{};
+        auto frame_hits = std::vector(path.size(), std::vector<wall_hit>(screen.ray_offsets.size()));
+        const auto poses = std::views::iota(std::size_t{0}, path.size());
+
+        std::printf("%-8s %12s %12s %12s %12s %12s %10s\n", "height", "rays ms", "walls ms", "rows ms", "columns ms",
+                    "cells/us", "differ");
+        for (const auto height : {60, 250, 1000})
+        {
+            auto frame = framebuffer(width, height);
+            auto per_column = framebuffer(width, height);
+            // the time per pose of f(pose, its wall hits)
+            const auto milliseconds_per_pose = [&](const auto& f) {
+                return milliseconds_per_frame(poses, [&](const std::size_t i) {
+                    arena.reset();
+                    f(path[i], frame_hits[i]);
+                });
+            };
+
+            const auto rays_ms = milliseconds_per_pose([&](const player& plyr, std::vector<wall_hit>& hits) {
+                const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(screen.ray_offsets[i]); };
+                compute_wall_hits(maze_map{}, std::span(hits), plyr.pos(), ray_dir, 1);
+            });
+            const auto walls_ms = milliseconds_per_pose([&](const player&, const std::vector<wall_hit>& hits) {
+                draw_walls<smooth_mode>(frame, hits, render_settings{});
+            });
+            const auto rows_ms = milliseconds_per_pose([&](const player& plyr, const std::vector<wall_hit>& hits) {
+                draw_walls<smooth_mode>(frame, hits, render_settings{});
+                cast_floor_and_ceiling<smooth_mode>(frame, plyr.view(), std::numeric_limits<float>::infinity(), arena);
+            }) - walls_ms;
+            const auto columns_ms = milliseconds_per_pose([&](const player& plyr, const std::vector<wall_hit>& hits) {
+                draw_walls<smooth_mode>(per_column, hits, render_settings{});
+                cast_floor_and_ceiling_per_column(per_column, plyr.view(), screen.ray_offsets);
+            }) - walls_ms;
+
+            auto cells = 0.0;
+            auto differ = std::size_t{0};
+            for (std::size_t i = 0; i < path.size(); ++i)
+            {
+                arena.reset();
+                draw_walls<smooth_mode>(frame, frame_hits[i], render_settings{});
+                for (int y = 0; y < height; ++y)
+                    cells += static_cast<double>(std::ranges::count_if(frame.row(y), [&](const cell& c) {
+                        return (c.attributes == attribute::none) and (c.glyph == ((2 * y + 1 > height) ? U'.' : U' '));
+                    }));
+                cast_floor_and_ceiling<smooth_mode>(frame, path[i].view(), std::numeric_limits<float>::infinity(),
+                                                    arena);
+                draw_walls<smooth_mode>(per_column, frame_hits[i], render_settings{});
+                cast_floor_and_ceiling_per_column(per_column, path[i].view(), screen.ray_offsets);
+                for (int y = 0; y < height; ++y)
+                    for (int x = 0; x < width; ++x)
+                        differ += (frame.row(y)[x] == per_column.row(y)[x]) ? 0 : 1;
+            }
+
+            const auto frames = static_cast<double>(std::max<std::size_t>(1, path.size()));
+            std::printf("%-8d %12.4f %12.4f %12.4f %12.4f %12.0f %10zu\n", height, rays_ms, walls_ms, rows_ms,
+                        columns_ms, cells / frames / (rows_ms * 1000.0), differ);
+        }
+    }
+
+    //  Sprites (see draw_sprites) from 10 up to 100k scattered over the maze: the time to build the grid, the frame
+    // time (see render) and the time of the sprites in it, and the time of the sprites when they are culled with the
+    // grid and sorted with std::sort instead of the radix sort and when all of them are projected (no grid) and
+    // sorted with std::sort, as well as the sprites in the cells of the frustum, the visible ones and the sprite
+    // columns drawn per frame
+    void benchmark_sprites(const std::vector<player>& path, const std::pair<int, int>& screen_size)
+    {
+        std::printf("%-8s %10s %10s %10s %10s %10s %10s %10s %10s\n", "sprites", "grid ms", "frame ms", "sprite ms",
+                    "std::sort", "no grid", "in cells", "visible", "columns");
+        for (const auto count : {10, 100, 1'000, 10'000, 100'000})
+        {
+            const auto sprites = scatter_sprites(maze_map{}, static_cast<std::size_t>(count));
+            const auto grid_start = std::chrono::steady_clock::now();
+            const auto grid = sprite_grid(maze_map{}, sprites);
+            const auto grid_end = std::chrono::steady_clock::now();
+            const auto grid_ms = std::chrono::duration<double, std::milli>(grid_end - grid_start);
+
+            auto screen = screen_buffers(screen_size);
+            auto arena = frame_arena{};
+            auto settings = render_settings{};
+            settings.sprites = &grid;
+            auto frame_ms = 0.0;
+            auto sprite_ms = 0.0;
+            auto stats = sprite_stats{};
+            for (const auto& plyr : path)
+            {
+                arena.reset();
+                const auto start = std::chrono::steady_clock::now();
+                const auto frame = render(screen, plyr, settings, arena);
+                frame_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                sprite_ms += frame.sprite_time.count();
+                stats.candidates += frame.sprites.candidates;
+                stats.visible += frame.sprites.visible;
+                stats.columns += frame.sprites.columns;
+            }
+
+            // the sprites with std::sort (far to near) after culling them with the grid or projecting all of them
+            const auto sorted_ms = [&](const bool is_culled) {
+                auto ms = 0.0;
+                for (const auto& plyr : path)
+                {
+                    arena.reset();
+                    const auto [hits, ray_stats] = draw_scene(screen.frame, screen.ray_offsets, plyr, {}, arena);
+                    const auto start = std::chrono::steady_clock::now();
+                    auto far = 0.0f;
+                    for (const auto& hit : hits)
+                        far = std::max(far, hit.distance);
+
+                    auto visible = std::span<projected_sprite>();
+                    if (is_culled)
+                    {
+                        visible = cull_sprites(grid, plyr.view(), far, screen.width, arena).visible;
+                    }
+                    else
+                    {
+                        const auto projection = sprite_projection(plyr.view(), screen.width);
+                        visible = arena.allocate<projected_sprite>(grid.size());
+                        auto n = std::size_t{0};
+                        for (std::uint32_t i = 0; i < grid.size(); ++i)
+                        {
+                            const auto p = projection(grid.sprites()[i], i);
+                            const auto is_visible = (p.depth >= sprite_projection::near_plane) and (p.depth <= far) and
+                                                    (p.center + p.half_width >= 0.0f) and
+                                                    (p.center - p.half_width < static_cast<float>(screen.width));
+                            if (is_visible) visible[n++] = p;
+                        }
+                        visible = visible.first(n);
+                    }
+                    std::ranges::sort(visible, std::greater<>{}, &projected_sprite::depth);
+                    draw_projected_sprites(screen.frame, hits, visible, grid);
+                    ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                }
+                return ms;
+            };
+
+            const auto frames = static_cast<double>(std::max<std::size_t>(1, path.size()));
+            std::printf("%-8d %10.4f %10.4f %10.4f %10.4f %10.4f %10.0f %10.1f %10.0f\n", count, grid_ms.count(),
+                        frame_ms / frames, sprite_ms / frames, sorted_ms(true) / frames, sorted_ms(false) / frames,
+                        static_cast<double>(stats.candidates) / frames, static_cast<double>(stats.visible) / frames,
+                        static_cast<double>(stats.columns) / frames);
+        }
+    }
+
+    template <std::size_t N, typename Map>
+    ray_stats compute_packed_wall_hits(const Map& map, const std::span<wall_hit> hits, const player& plyr,
+                                       const std::span<const float> ray_offsets)
+    {
+        const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(ray_offsets[i]); };
+        return compute_wall_hits_packed<N>(map, hits, plyr.pos(), ray_dir);
+    }
+
+#if WSTERM_ISA_DISPATCH
+    // The same kernel compiled for AVX-512, where a pack of 16 floats is one register
+    template <typename Map>
+    [[gnu::target("avx512f,avx512bw,avx512vl"), gnu::flatten]] ray_stats
+    compute_packed_wall_hits_avx512(const Map& map, const std::span<wall_hit> hits, const player& plyr,
+                                    const std::span<const float> ray_offsets)
+    {
+        return compute_packed_wall_hits<16>(map, hits, plyr, ray_offsets);
+    }
+#endif
+
+    //  Casting the rays of packs of neighbouring columns at once (see compute_wall_hits_packed) with a range of
+    // pack widths, compared with casting one ray after the other, in the maze and in generated maps with small
+    // and big rooms (where rays are longer). The packed results must be exactly the same. So far packing only
+    // breaks even in the maze (see compute_wall_hits_packed).
+    void benchmark_packed_rays(const std::vector<player>& path, const int width)
+    {
+        const auto has_avx512 = WSTERM_ISA_DISPATCH and (detect_isa() == isa::avx512);
+        std::printf("%-16s %10s %10s %10s %10s %10s %10s\n", "map", "scalar ms", "4 lanes", "8 lanes", "16 lanes",
+                    "16 avx512", "mismatches");
+
+        const auto run = [&](const char* name, const auto& map, const std::vector<player>& poses) {
+            const auto scalar = [&](const std::span<wall_hit> hits, const player& plyr,
+                                    const std::span<const float> ray_offsets, frame_arena&) {
+                const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(ray_offsets[i]); };
+                return compute_wall_hits(map, hits, plyr.pos(), ray_dir, 1);
+            };
+            const auto packed = [&]<std::size_t N>(std::integral_constant<std::size_t, N>) {
+                return [&](const std::span<wall_hit> hits, const player& plyr, const std::span<const float> ray_offsets,
+                           frame_arena&) { return compute_packed_wall_hits<N>(map, hits, plyr, ray_offsets); };
+            };
+            const auto packed_4 = packed(std::integral_constant<std::size_t, 4>{});
+            const auto packed_8 = packed(std::integral_constant<std::size_t, 8>{});
+            const auto packed_16 = packed(std::integral_constant<std::size_t, 16>{});
+
+            auto mismatches = count_mismatches(map, poses, width, packed_4) +
+                              count_mismatches(map, poses, width, packed_8) +
+                              count_mismatches(map, poses, width, packed_16);
+            auto avx512_ms = 0.0;
+#if WSTERM_ISA_DISPATCH
+            if (has_avx512)
+            {
+                const auto packed_avx512 = [&](const std::span<wall_hit> hits, const player& plyr,
+                                               const std::span<const float> ray_offsets, frame_arena&) {
+                    return compute_packed_wall_hits_avx512(map, hits, plyr, ray_offsets);
+                };
+                mismatches += count_mismatches(map, poses, width, packed_avx512);
+                avx512_ms = milliseconds_per_frame(poses, width, packed_avx512);
+            }
+#endif
+            std::printf("%-16s %10.4f %10.4f %10.4f %10.4f ", name, milliseconds_per_frame(poses, width, scalar),
+                        milliseconds_per_frame(poses, width, packed_4), milliseconds_per_frame(poses, width, packed_8),
+                        milliseconds_per_frame(poses, width, packed_16));
+            if (has_avx512)
+                std::printf("%10.4f %10zu\n", avx512_ms, expect_zero(mismatches));
+            else
+                std::printf("%10s %10zu\n", "-", expect_zero(mismatches));
+        };
+
+        run("maze", maze_map{}, path);
+        run("maze grid", grid_map(maze_map{}), path);
+        for (const auto room_size : {16, 256})
+        {
+            const auto size = 1024;
+            const auto map = generate_map(size, size, room_size);
+            const auto center = static_cast<float>((size / 2 / room_size) * room_size + room_size / 2) + 0.5f;
+            auto poses = std::vector<player>(200, player(vec2f{center, center}));
+            for (std::size_t i = 1; i < poses.size(); ++i)
+            {
+                poses[i] = poses[i - 1];
+                poses[i].turn(1.0f, 1.0f / 30.0f);
+            }
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "rooms of %d", room_size);
+            run(name, map, poses);
+        }
+    }
+
+    //  The kernels compiled for every instruction set that the CPU supports: the time to compute the wall hits
+    // in the maze and to diff and encode a frame, and whether the results are exactly the same as those of the
+    // baseline kernels (the number of columns with different wall hits and of frames with different encodings).
+    void benchmark_kernels(const std::vector<player>& path, const std::pair<int, int>& screen_size)
+    {
+        std::printf("%-10s %10s %10s %10s %10s\n", "isa", "rays ms", "encode ms", "mismatches", "encodings");
+
+        // render the whole camera path once, the encoders then diff every pair of consecutive frames
+        auto screen = screen_buffers(screen_size);
+        auto arena = frame_arena{};
+        auto frames = std::vector<framebuffer>();
+        frames.reserve(path.size());
+        for (const auto& plyr : path)
+        {
+            arena.reset();
+            render(screen, plyr, render_settings{}, arena);
+            frames.push_back(screen.frame);
+        }
+
+        const auto settings = render_settings{};
+        const auto& baseline = kernels_for(isa::baseline);
+        for (const auto i : {isa::baseline, isa::avx2, isa::avx512})
+        {
+            if (i > detect_isa()) break;
+            const auto& kernels = kernels_for(i);
+            const auto compute = [&](const std::span<wall_hit> hits, const player& plyr,
+                                     const std::span<const float> ray_offsets, frame_arena&) {
+                return kernels.compute_maze_wall_hits(hits, plyr.view(), ray_offsets, settings.span_width,
+                                                      settings.column_step, settings.limits, settings.casting);
+            };
+            const auto rays_ms = milliseconds_per_frame(path, screen_size.first, compute);
+            const auto mismatches = count_mismatches(maze_map{}, path, screen_size.first, compute);
+
+            auto different_encodings = std::size_t{0};
+            for (std::size_t f = 1; f < frames.size(); ++f)
+            {
+                arena.reset();
+                const auto expected = baseline.encode_changes(frames[f], frames[f - 1], arena);
+                const auto encoded = kernels.encode_changes(frames[f], frames[f - 1], arena);
+                const auto is_same = std::ranges::equal(expected.runs, encoded.runs, [](const auto& a, const auto& b) {
+                    return (a.x == b.x) and (a.y == b.y) and (a.attributes == b.attributes) and (a.color == b.color) and
+                           (a.text == b.text);
+                });
+                if (!is_same) ++different_encodings;
+            }
+
+            constexpr auto repetitions = 10;
+            const auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repetitions; ++r)
+                for (std::size_t f = 1; f < frames.size(); ++f)
+                {
+                    arena.reset();
+                    kernels.encode_changes(frames[f], frames[f - 1], arena);
+                }
+            const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+            const auto num_encodings = static_cast<double>(repetitions) * static_cast<double>(frames.size() - 1);
+            const auto encode_ms = elapsed.count() / std::max(1.0, num_encodings);
+
+            std::printf("%-10s %10.4f %10.4f %10zu %10zu\n", isa_name(i).data(), rays_ms, encode_ms,
+                        expect_zero(mismatches), expect_zero(different_encodings));
+        }
+    }
+
+    //  Compare casting rays through the grid with drawing the segments of a BSP tree as the map grows (both
+    // with small rooms and with big open rooms). The camera spins on the spot in the room closest to the
+    // center of a generated map and only the wall hits are computed (nothing is drawn).
+    void benchmark_map_sizes(const int width)
+    {
+        std::printf("%-10s %6s %10s %10s %10s %10s %10s %10s\n", "map size", "rooms", "segments", "build ms", "dda ms",
+                    "span ms", "bsp ms", "mismatches");
+
+        for (const auto& [size, room_size] : {std::pair(32, 16), std::pair(128, 16), std::pair(512, 16),
+                                              std::pair(2048, 16), std::pair(512, 256), std::pair(2048, 256)})
+        {
+            const auto map = generate_map(size, size, room_size);
+
+            const auto start = std::chrono::steady_clock::now();
+            const auto tree = bsp_tree(map);
+            const auto build_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+            const auto center = static_cast<float>((size / 2 / room_size) * room_size + room_size / 2) + 0.5f;
+            auto path = std::vector<player>(200, player(vec2f{center, center}));
+            for (std::size_t i = 1; i < path.size(); ++i)
+            {
+                path[i] = path[i - 1];
+                path[i].turn(1.0f, 1.0f / 30.0f);
+            }
+
+            const auto cast_every_column = [&](const std::span<wall_hit> hits, const player& plyr,
+                                               const std::span<const float> ray_offsets, frame_arena&) {
+                const auto ray_dir = [&](const std::size_t i) { return plyr.camera_ray(ray_offsets[i]); };
+                return compute_wall_hits(map, hits, plyr.pos(), ray_dir, 1);
+            };
+
+            std::printf("%-10d %6d %10zu %10.1f %10.4f %10.4f %10.4f %10zu\n", size, room_size, tree.num_segments(),
+                        build_time.count(), milliseconds_per_frame(path, width, cast_every_column),
+                        milliseconds_per_frame(path, width, span_coherence(map)),
+                        milliseconds_per_frame(path, width, bsp(map, tree)),
+                        expect_zero(count_mismatches(map, path, width, bsp(map, tree))));
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const auto arg = [&](const int i, const int default_value) {
+        return (argc > i) ? std::atoi(argv[i]) : default_value;
+    };
+    const auto width = arg(1, 200);
+    const auto height = arg(2, 60);
+    const auto num_frames = arg(3, 1000);
+
+    const auto path = camera_path(num_frames);
+    const auto screen_size = std::pair(width, height);
+
+    std::printf("%d frames at %dx%d\n\n", num_frames, width, height);
+    std::printf("%-20s %10s %10s %10s %10s %10s %12s\n", "", "ms/frame", "bytes", "changes", "rays", "scale",
+                "allocations");
+    benchmark("cast every column", path, screen_size, render_settings{.span_width = 1});
+    benchmark("span coherence", path, screen_size, render_settings{});
+    benchmark("bsp", path, screen_size, render_settings{.caster = wall_caster::bsp});
+    benchmark("blocky", path, screen_size, render_settings{.mode = render_mode::blocky});
+    benchmark("braille", path, screen_size, render_settings{.mode = render_mode::braille});
+    benchmark("shaded", path, screen_size, render_settings{.mode = render_mode::shaded});
+    benchmark("dithered", path, screen_size, render_settings{.is_dithered = true});
+    benchmark("textured", path, screen_size, render_settings{.mode = render_mode::textured});
+    benchmark("floor cast", path, screen_size, render_settings{.is_floor_cast = true});
+    const auto sprites = sprite_grid(maze_map{}, scatter_sprites(maze_map{}, 1'000));
+    benchmark("1000 sprites", path, screen_size, render_settings{.sprites = &sprites});
+    benchmark("select stepping", path, screen_size, render_settings{.casting = {.stepping = dda_stepping::select}});
+    benchmark("unrolled stepping", path, screen_size,
+              render_settings{.casting = {.stepping = dda_stepping::unrolled}});
+    benchmark("column step 2", path, screen_size, render_settings{.column_step = 2});
+    benchmark("column step 3", path, screen_size, render_settings{.column_step = 3});
+    benchmark("adaptive (0.05 ms)", path, screen_size, render_settings{}, 0.05f);
+    const auto maze_table = wall_hit_table(maze_map{});
+    benchmark("table", path, screen_size, render_settings{.caster = wall_caster::table, .table = &maze_table});
+    benchmark("progressive (2 ms)", path, screen_size, render_settings{.caster = wall_caster::progressive});
+    benchmark("progressive (2 us)", path, screen_size,
+              render_settings{.caster = wall_caster::progressive, .ray_budget = std::chrono::microseconds(2)});
+
+    std::printf("\nmismatches against casting every column:\n");
+    const auto maze = maze_map{};
+    std::printf("span coherence:   %zu columns\n",
+                expect_zero(count_mismatches(maze, path, width, span_coherence(maze))));
+    std::printf("bsp:              %zu columns\n",
+                expect_zero(count_mismatches(maze, path, width, bsp(maze, maze_bsp()))));
+
+    std::printf("\nprogressive wall caster with %d columns:\n\n", width);
+    benchmark_ray_budgets(path, width);
+
+    std::printf("\nlookup table of the maze with %d columns:\n\n", width);
+    benchmark_wall_hit_table(path, width);
+
+    std::printf("\nray limits with %d columns (cells visited per ray):\n\n", width);
+    benchmark_ray_limits(width);
+
+    std::printf("\nbaked maze with %d columns:\n\n", width);
+    benchmark_baked_map(path, width);
+
+    std::printf("\nmap layouts with %d columns:\n\n", width);
+    benchmark_map_layouts(width);
+
+    std::printf("\ndda stepping (rays in a field with pillars):\n\n");
+    benchmark_dda_stepping();
+
+    std::printf("\nscalar types far from the origin (rays in a lattice of rooms):\n\n");
+    benchmark_scalar_types();
+
+    std::printf("\nfast math against libm:\n\n");
+    benchmark_fast_math(path, width);
+
+    std::printf("\ndrawing the columns in each rendering mode on a %dx%d screen (rows that differ):\n\n",
+                screen_size.first, screen_size.second);
+    benchmark_render_modes(path, screen_size);
+
+    std::printf("\nterminal output with and without shading on a %dx%d screen:\n\n", screen_size.first,
+                screen_size.second);
+    benchmark_shading(path, screen_size);
+
+    std::printf("\nframe breakdown with post-processing on a %dx%d screen:\n\n", screen_size.first,
+                screen_size.second);
+    benchmark_post_processing(path, screen_size);
+
+    std::printf("\ntextured walls with %d columns (per frame):\n\n", width);
+    benchmark_textures(path, width);
+
+    std::printf("\nfloor and ceiling casting against wall casting with %d columns (per frame):\n\n", width);
+    benchmark_floor_casting(path, width);
+
+    std::printf("\nsprites in the maze on a %dx%d screen (per frame):\n\n", screen_size.first, screen_size.second);
+    benchmark_sprites(path, screen_size);
+
+    std::printf("\npacked rays with %d columns:\n\n", width);
+    benchmark_packed_rays(path, width);
+
+    std::printf("\nkernels per instruction set (the CPU supports up to %s):\n\n", isa_name(detect_isa()).data());
+    benchmark_kernels(path, screen_size);
+
+    std::printf("\nwall hits only for growing maps with %d columns:\n\n", width);
+    benchmark_map_sizes(width);
+
+    // the differences that are expected (approximations like the fast reciprocal or texels picked by stepping
+    // instead of dividing) are only reported, everything else that differs fails the benchmark
+    if (failed_checks == 0) return EXIT_SUCCESS;
+    std::fprintf(stderr, "\n%zu checks failed (steady-state allocations or results that differ from the reference)\n",
+                 failed_checks);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,380 @@
+#pragma once
+
+#include <frame_arena.hpp>
+#include <math.hpp>
+#include <raycaster.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
+
+//  An alternative to casting a ray per column through the grid, for maps made of long straight runs
+// of wall. The unit faces of the wall cells are merged into wall segments which are sorted into a BSP
+// tree once. Per frame the tree is traversed front to back and each segment claims the columns that
+// have not been claimed by a nearer segment yet, so the traversal stops as soon as every column is
+// covered. The wall hit of a column is computed by intersect_wall_face, i.e. exactly as the DDA does.
+
+// A maximal straight run of unit wall faces that are visible from the same side. Segments with is_x
+// set lie on the line x = line and span y in [begin, end], all others lie on the line y = line and
+// span x in [begin, end]. The wall cells behind the faces are at x (or y) = wall which is either line
+// (the faces are seen from the negative side) or line - 1 (the faces are seen from the positive side).
+struct wall_segment
+{
+    bool is_x = false;
+    int line = 0;
+    int begin = 0;
+    int end = 0;
+    int wall = 0;
+
+    // whether the faces of the segment can be seen from the given position
+    [[nodiscard]] constexpr bool faces(const vec2f& pos) const
+    {
+        const auto p = is_x ? pos.x : pos.y;
+        return (wall == line) ? (p < static_cast<float>(line)) : (p > static_cast<float>(line));
+    }
+};
+
+// Greedily merge the faces of wall cells that border an empty cell into maximal straight wall segments
+template <typename Map>
+std::vector<wall_segment> extract_wall_segments(const Map& map)
+{
+    auto segments = std::vector<wall_segment>{};
+
+    // walk along each grid line (with the cells at across - 1 and across on either side of the line)
+    // and collect the runs of faces that separate a wall cell on one side from an empty cell on the other
+    const auto extract = [&](const bool is_x, const int num_lines, const int length) {
+        const auto is_wall = [&](const int across, const int along) {
+            return map.is_wall(is_x ? vec2i{across, along} : vec2i{along, across});
+        };
+
+        for (int line = 1; line < num_lines; ++line)
+        {
+            for (const auto wall : {line, line - 1})
+            {
+                const auto empty = (wall == line) ? line - 1 : line;
+                const auto is_face = [&](const int along) { return is_wall(wall, along) and !is_wall(empty, along); };
+                for (int along = 0; along < length;)
+                {
+                    if (!is_face(along))
+                    {
+                        ++along;
+                        continue;
+                    }
+
+                    const auto begin = along;
+                    while ((along < length) and is_face(along))
+                        ++along;
+                    segments.push_back({.is_x = is_x, .line = line, .begin = begin, .end = along, .wall = wall});
+                }
+            }
+        }
+    };
+
+    extract(true, map.width(), map.height());
+    extract(false, map.height(), map.width());
+    return segments;
+}
+
+class bsp_tree
+{
+public:
+    template <typename Map>
+    explicit bsp_tree(const Map& map)
+        : bsp_tree(extract_wall_segments(map))
+    {
+    }
+
+    explicit bsp_tree(std::vector<wall_segment> segments) { root_ = build(std::move(segments)); }
+
+    [[nodiscard]] std::size_t num_segments() const { return segments_.size(); }
+    [[nodiscard]] std::size_t num_nodes() const { return nodes_.size(); }
+
+    //  Compute the wall hit for each column (the ray of column i is cam.ray(ray_offsets[i]), and the
+    // offsets must be increasing). A ray that is not claimed by any segment (which can only happen
+    // when rounding lets it slip through the corner where two segments meet) or that hits a segment
+    // within corner_margin of one of its ends (where rounding may pick a different segment than the
+    // DDA does) falls back to the DDA on the map. The number of those fallback rays is reported as the
+    // number of rays cast.
+    template <typename Map>
+    ray_stats compute_wall_hits(const Map& map, const std::span<wall_hit> hits, const camera& cam,
+                                const std::span<const float> ray_offsets, frame_arena& arena) const
+    {
+        auto t = traversal{.cam = cam,
+                           .ray_offsets = ray_offsets,
+                           .hits = hits,
+                           .next_uncovered = arena.allocate<std::uint32_t>(hits.size() + 1),
+                           .corner_columns = arena.allocate<std::uint32_t>(hits.size()),
+                           .remaining = hits.size()};
+        std::iota(t.next_uncovered.begin(), t.next_uncovered.end(), 0u);
+
+        if (!hits.empty()) traverse(root_, t);
+
+        auto stats = ray_stats{.columns = hits.size(), .rays_cast = t.num_corner_columns};
+        for (const auto i : t.corner_columns.first(t.num_corner_columns))
+            hits[i] = compute_wall_hit(map, cam.pos, cam.ray(ray_offsets[i]));
+        for (auto i = t.find_uncovered(0); i < hits.size(); i = t.find_uncovered(i + 1))
+        {
+            hits[i] = compute_wall_hit(map, cam.pos, cam.ray(ray_offsets[i]));
+            ++stats.rays_cast;
+        }
+
+        return stats;
+    }
+
+private:
+    // How close to the end of a segment (in cells) a hit must be to be left to the DDA. This is far more than
+    // the rounding errors of the hit positions on maps of up to a few thousand cells.
+    static constexpr float corner_margin = 1.0f / 256.0f;
+
+    struct bounding_box
+    {
+        vec2f min;
+        vec2f max;
+    };
+
+    // A node holds the segments that lie on its splitting line and the subtrees with the segments on
+    // either side of the line (-1 if there are none). The bounds cover all segments in the subtree.
+    struct node
+    {
+        bool is_x = false;
+        int line = 0;
+        std::uint32_t first_segment = 0;
+        std::uint32_t num_segments = 0;
+        std::int32_t below = -1;
+        std::int32_t above = -1;
+        bounding_box bounds;
+    };
+
+    // The per frame state of a front to back traversal. Covered columns are skipped with a union-find
+    // style array: next_uncovered[i] leads to the first uncovered column at or after column i.
+    struct traversal
+    {
+        camera cam;
+        std::span<const float> ray_offsets;
+        std::span<wall_hit> hits;
+        std::span<std::uint32_t> next_uncovered;
+        std::span<std::uint32_t> corner_columns;  // the columns claimed close to the end of a segment
+        std::size_t num_corner_columns = 0;
+        std::size_t remaining = 0;
+
+        std::uint32_t find_uncovered(std::uint32_t i)
+        {
+            while (next_uncovered[i] != i)
+            {
+                next_uncovered[i] = next_uncovered[next_uncovered[i]];
+                i = next_uncovered[i];
+            }
+            return i;
+        }
+
+        void cover(const std::uint32_t i)
+        {
+            next_uncovered[i] = i + 1;
+            --remaining;
+        }
+
+        //  The range of columns [first, last] whose rays may pass between the given points, which is empty
+        // (first > last) if everything is behind the camera and conservatively all columns if only some
+        // of the points are behind the camera.
+        [[nodiscard]] std::pair<std::uint32_t, std::uint32_t> columns_between(const std::span<const vec2f> points) const
+        {
+            const auto cross = [](const vec2f& a, const vec2f& b) { return a.x * b.y - a.y * b.x; };
+            const auto num_columns = static_cast<std::uint32_t>(hits.size());
+
+            // express each point relative to the camera as depth * forward + side * right
+            const auto plane = cross(cam.forward, cam.right);
+            auto min_offset = 0.0f;
+            auto max_offset = 0.0f;
+            auto num_behind = std::size_t{0};
+            for (std::size_t i = 0; i < points.size(); ++i)
+            {
+                const auto v = points[i] - cam.pos;
+                const auto depth = cross(v, cam.right) / plane;
+                const auto side = cross(cam.forward, v) / plane;
+                if (depth <= 1e-4f)
+                {
+                    ++num_behind;
+                    continue;
+                }
+
+                const auto offset = side / depth;
+                min_offset = (i == num_behind) ? offset : std::min(min_offset, offset);
+                max_offset = (i == num_behind) ? offset : std::max(max_offset, offset);
+            }
+
+            if (num_behind == points.size()) return {1, 0};
+            if (num_behind > 0) return {0, num_columns - 1};
+
+            const auto first = std::ranges::lower_bound(ray_offsets, min_offset) - ray_offsets.begin();
+            const auto last = std::ranges::upper_bound(ray_offsets, max_offset) - ray_offsets.begin();
+            return {static_cast<std::uint32_t>(std::max<std::ptrdiff_t>(0, first - 1)),
+                    static_cast<std::uint32_t>(std::min<std::ptrdiff_t>(num_columns - 1, last))};
+        }
+
+        //  Claim all uncovered columns whose rays hit the segment. Rays that pass within corner_margin of the
+        // ends of the segment are claimed too, but their hits are left to the DDA (see compute_wall_hits).
+        void draw(const wall_segment& segment)
+        {
+            if (!segment.faces(cam.pos)) return;
+
+            const auto [p0, p1] = endpoints(segment);
+            const auto points = std::array{p0, p1};
+            const auto [first, last] = columns_between(points);
+            for (auto i = find_uncovered(first); i <= last; i = find_uncovered(i + 1))
+            {
+                const auto dir = cam.ray(ray_offsets[i]);
+                const auto face = wall_face{.cell = segment.is_x ? vec2i{segment.wall, 0} : vec2i{0, segment.wall},
+                                            .is_x = segment.is_x};
+                const auto hit = intersect_wall_face(cam.pos, dir, face);
+                const auto along = segment.is_x ? cam.pos.y + hit.distance * dir.y : cam.pos.x + hit.distance * dir.x;
+                const auto is_towards_wall = ((segment.is_x ? dir.x : dir.y) < 0.0f) == (segment.wall != segment.line);
+                const auto from_begin = along - static_cast<float>(segment.begin);
+                const auto to_end = static_cast<float>(segment.end) - along;
+                if (is_towards_wall and (hit.distance > 0.0f) and (from_begin >= -corner_margin)
+                    and (to_end >= -corner_margin))
+                {
+                    hits[i] = hit;
+                    if (std::min(from_begin, to_end) < corner_margin) corner_columns[num_corner_columns++] = i;
+                    cover(i);
+                }
+            }
+        }
+    };
+
+    static std::pair<vec2f, vec2f> endpoints(const wall_segment& s)
+    {
+        const auto f = [](const int i) { return static_cast<float>(i); };
+        return s.is_x ? std::pair(vec2f{f(s.line), f(s.begin)}, vec2f{f(s.line), f(s.end)})
+                      : std::pair(vec2f{f(s.begin), f(s.line)}, vec2f{f(s.end), f(s.line)});
+    }
+
+    void traverse(const std::int32_t index, traversal& t) const
+    {
+        if ((index < 0) or (t.remaining == 0)) return;
+
+        // skip the whole subtree if it can't be seen or if all the columns it could cover are covered
+        const auto& n = nodes_[static_cast<std::size_t>(index)];
+        const auto& [min, max] = n.bounds;
+        const auto corners = std::array{min, vec2f{min.x, max.y}, max, vec2f{max.x, min.y}};
+        if (const auto [first, last] = t.columns_between(corners); (first > last) or (t.find_uncovered(first) > last))
+            return;
+
+        // front to back: first the side of the splitting line that the camera is on, then the segments
+        // on the line, then the other side
+        const auto is_below = (n.is_x ? t.cam.pos.x : t.cam.pos.y) < static_cast<float>(n.line);
+        traverse(is_below ? n.below : n.above, t);
+        for (auto i = n.first_segment; i < n.first_segment + n.num_segments; ++i)
+            t.draw(segments_[i]);
+        traverse(is_below ? n.above : n.below, t);
+    }
+
+    //  Choose a splitting line among a sample of the segments, preferring lines that split few segments
+    // and that divide the remaining segments evenly, and sort the segments into the node and its subtrees.
+    std::int32_t build(std::vector<wall_segment> segments)
+    {
+        if (segments.empty()) return -1;
+
+        struct split
+        {
+            std::vector<wall_segment> on_line;
+            std::vector<wall_segment> below;
+            std::vector<wall_segment> above;
+        };
+
+        const auto partition = [&](const bool is_x, const int line, split* result) {
+            auto num_below = std::size_t{0};
+            auto num_above = std::size_t{0};
+            auto num_split = std::size_t{0};
+            for (const auto& s : segments)
+            {
+                if (s.is_x == is_x)
+                {
+                    if (s.line == line)
+                    {
+                        if (result) result->on_line.push_back(s);
+                        continue;
+                    }
+
+                    ++((s.line < line) ? num_below : num_above);
+                    if (result) ((s.line < line) ? result->below : result->above).push_back(s);
+                }
+                else if (s.end <= line)
+                {
+                    ++num_below;
+                    if (result) result->below.push_back(s);
+                }
+                else if (s.begin >= line)
+                {
+                    ++num_above;
+                    if (result) result->above.push_back(s);
+                }
+                else
+                {
+                    ++num_split;
+                    if (result)
+                    {
+                        auto lower = s;
+                        auto upper = s;
+                        lower.end = upper.begin = line;
+                        result->below.push_back(lower);
+                        result->above.push_back(upper);
+                    }
+                }
+            }
+
+            const auto signed_size = [](const std::size_t n) { return static_cast<std::ptrdiff_t>(n); };
+            return 8 * signed_size(num_split) + std::abs(signed_size(num_below) - signed_size(num_above));
+        };
+
+        constexpr auto num_candidates = std::size_t{16};
+        const auto stride = std::max<std::size_t>(1, segments.size() / num_candidates);
+        auto best = segments.front();
+        auto best_score = std::numeric_limits<std::ptrdiff_t>::max();
+        for (std::size_t i = 0; i < segments.size(); i += stride)
+        {
+            if (const auto score = partition(segments[i].is_x, segments[i].line, nullptr); score < best_score)
+            {
+                best = segments[i];
+                best_score = score;
+            }
+        }
+
+        auto result = split{};
+        partition(best.is_x, best.line, &result);
+
+        auto bounds = bounding_box{.min = endpoints(segments.front()).first, .max = endpoints(segments.front()).first};
+        for (const auto& s : segments)
+        {
+            for (const auto& p : {endpoints(s).first, endpoints(s).second})
+            {
+                bounds.min = {std::min(bounds.min.x, p.x), std::min(bounds.min.y, p.y)};
+                bounds.max = {std::max(bounds.max.x, p.x), std::max(bounds.max.y, p.y)};
+            }
+        }
+        segments = {};
+
+        const auto index = static_cast<std::int32_t>(nodes_.size());
+        nodes_.push_back({.is_x = best.is_x,
+                          .line = best.line,
+                          .first_segment = static_cast<std::uint32_t>(segments_.size()),
+                          .num_segments = static_cast<std::uint32_t>(result.on_line.size()),
+                          .bounds = bounds});
+        segments_.insert(segments_.end(), result.on_line.begin(), result.on_line.end());
+
+        const auto below = build(std::move(result.below));
+        const auto above = build(std::move(result.above));
+        nodes_[static_cast<std::size_t>(index)].below = below;
+        nodes_[static_cast<std::size_t>(index)].above = above;
+        return index;
+    }
+
+    std::vector<node> nodes_;
+    std::vector<wall_segment> segments_;
+    std::int32_t root_ = -1;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <frame_arena.hpp>
+#include <framebuffer.hpp>
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+// A run of UTF-8 encoded text starting at a given screen position where all characters share the
+// same attributes and color. This is the unit in which changes are sent to the terminal.
+struct text_run
+{
+    int x = 0;
+    int y = 0;
+    std::uint8_t attributes = attribute::none;
+    std::uint8_t color = 0;
+    std::string_view text;
+};
+
+// A blank cell (a space without attributes) looks the same in any color, so it can be part of a run of any color
+constexpr bool is_blank(const cell& c) { return (c.glyph == U' ') and (c.attributes == attribute::none); }
+
+// Write the UTF-8 encoding of c to out (which must have space for at least 4 bytes) and return
+// the number of bytes written
+constexpr int encode_utf8(const char32_t c, char* out)
+{
+    if (c < 0x80)
+    {
+        out[0] = static_cast<char>(c);
+        return 1;
+    }
+    if (c < 0x800)
+    {
+        out[0] = static_cast<char>(0xc0 | (c >> 6));
+        out[1] = static_cast<char>(0x80 | (c & 0x3f));
+        return 2;
+    }
+    if (c < 0x10000)
+    {
+        out[0] = static_cast<char>(0xe0 | (c >> 12));
+        out[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+        out[2] = static_cast<char>(0x80 | (c & 0x3f));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xf0 | (c >> 18));
+    out[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+    out[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+    out[3] = static_cast<char>(0x80 | (c & 0x3f));
+    return 4;
+}
+
+//  The first column at or after x where the two rows differ (or the width of the rows if there is none).
+// The rows are compared a block of cells at a time without an early exit within the block, so that the
+// compiler can vectorize the comparison (with whatever the target instruction set offers, see kernels.hpp).
+inline int find_difference(const std::span<const cell> row, const std::span<const cell> previous_row, int x)
+{
+    constexpr auto block_size = 16;
+    const auto width = static_cast<int>(row.size());
+    for (; x + block_size <= width; x += block_size)
+    {
+        auto is_different = false;
+        for (int i = x; i < x + block_size; ++i)
+            is_different |= (row[i].glyph != previous_row[i].glyph) |
+                            (row[i].attributes != previous_row[i].attributes) | (row[i].color != previous_row[i].color);
+        if (is_different) break;
+    }
+
+    while ((x < width) and (row[x] == previous_row[x]))
+        ++x;
+    return x;
+}
+
+// The result of encoding a frame: the runs that have to be sent to the terminal, the total number of encoded
+// bytes in those runs and how many times the attributes or the color change from one run to the next (each
+// change costs the terminal an escape sequence on top of the text)
+struct encoded_frame
+{
+    std::span<const text_run> runs;
+    std::size_t bytes = 0;
+    std::size_t style_changes = 0;
+};
+
+//  Encode the cells of frame that differ from previous (the frame that is currently displayed) into runs
+// of text. A run is a maximal horizontal sequence of changed cells with the same attributes and color, where
+// blank cells take on whatever color the run has (or the previous run had), so that they don't break runs or
+// cause color changes. If the two frames have different sizes, everything is encoded. All memory comes from the
+// frame arena.
+inline encoded_frame encode_changes(const framebuffer& frame, const framebuffer& previous, frame_arena& arena)
+{
+    const auto is_full_frame = (frame.width() != previous.width()) or (frame.height() != previous.height());
+
+    // worst case: every cell is a run of its own and every glyph needs 4 bytes
+    const auto num_cells = static_cast<std::size_t>(frame.width()) * static_cast<std::size_t>(frame.height());
+    const auto runs = arena.allocate<text_run>(num_cells);
+    const auto bytes = arena.allocate<char>(num_cells * 4);
+
+    auto num_runs = std::size_t{0};
+    auto num_bytes = std::size_t{0};
+    auto num_style_changes = std::size_t{0};
+    auto color = std::uint8_t{0};
+    auto previous_attributes = attribute::none;
+    for (int y = 0; y < frame.height(); ++y)
+    {
+        const auto row = frame.row(y);
+        const auto previous_row = is_full_frame ? row : previous.row(y);
+        for (int x = is_full_frame ? 0 : find_difference(row, previous_row, 0); x < frame.width();
+             x = is_full_frame ? x : find_difference(row, previous_row, x))
+        {
+            const auto run_start = x;
+            const auto text_start = num_bytes;
+            const auto attributes = row[x].attributes;
+            const auto previous_color = color;
+            if (!is_blank(row[x])) color = row[x].color;
+
+            for (; (x < frame.width()) and (row[x].attributes == attributes) and
+                   (is_blank(row[x]) or (row[x].color == color)) and (is_full_frame or (row[x] != previous_row[x]));
+                 ++x)
+                num_bytes += static_cast<std::size_t>(encode_utf8(row[x].glyph, bytes.data() + num_bytes));
+
+            num_style_changes += ((attributes != previous_attributes) or (color != previous_color)) ? 1 : 0;
+            previous_attributes = attributes;
+            runs[num_runs++] = {run_start, y, attributes, color, {bytes.data() + text_start, num_bytes - text_start}};
+        }
+    }
+
+    return {runs.first(num_runs), num_bytes, num_style_changes};
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <math.hpp>
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+//  Fast approximations of the transcendental functions and the reciprocal for floats, as an alternative to
+// libm (see scalar_traits) for code that opts into it. Everything is branch free (selects instead of jumps)
+// and does not call into libm, so that loops over these functions vectorize (see the span versions). The
+// error bounds are measured against double precision libm by wsterm_bench (see benchmark_fast_math) and
+// hold for the given ranges; there is no special handling of NaNs.
+namespace fast_math
+{
+    //  c ? a : b without a jump. GCC turns conditional expressions into jumps when it sinks a computation that
+    // might trap (like a division) into the branch that needs it, and a loop with jumps does not vectorize.
+    constexpr float select(const bool c, const float a, const float b)
+    {
+        const auto mask = -static_cast<std::uint32_t>(c);
+        const auto bits = (std::bit_cast<std::uint32_t>(a) & mask) | (std::bit_cast<std::uint32_t>(b) & ~mask);
+        return std::bit_cast<float>(bits);
+    }
+
+    struct sincos_result
+    {
+        float sin;
+        float cos;
+    };
+
+    //  The sine and cosine of x (in radians) at once. The angle is reduced to [-pi/4, pi/4] (pi/2 is split
+    // into three parts, so the reduction is exact for moderate angles) and then polynomials (from Cephes)
+    // approximate both functions. Max absolute error 1e-7 for |x| <= 1000 (libm: 3.3e-8).
+    constexpr sincos_result sincos(const float x)
+    {
+        constexpr auto two_over_pi = 0.636619772f;
+        const auto quadrant = static_cast<int>(x * two_over_pi + select(x < 0.0f, -0.5f, 0.5f));
+        const auto k = static_cast<float>(quadrant);
+        const auto r = ((x - k * 1.5703125f) - k * 4.837512969970703125e-4f) - k * 7.54978995489188216e-8f;
+        const auto r2 = r * r;
+
+        const auto sin_r = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+        const auto cos_p = 4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f);
+        const auto cos_r = 1.0f - 0.5f * r2 + r2 * r2 * cos_p;
+
+        // the quadrant swaps sine and cosine and flips their signs
+        const auto q = static_cast<unsigned>(quadrant);
+        const auto is_swapped = (q & 1u) != 0;
+        const auto sin_x = select(is_swapped, cos_r, sin_r);
+        const auto cos_x = select(is_swapped, sin_r, cos_r);
+        return {.sin = select((q & 2u) != 0, -sin_x, sin_x), .cos = select(((q + 1u) & 2u) != 0, -cos_x, cos_x)};
+    }
+
+    //  The angle of the vector (x, y) in radians in [-pi, pi] (like std::atan2). The ratio of the smaller to
+    // the larger component is reduced to [-tan(pi/8), tan(pi/8)] and a polynomial (from Cephes) approximates
+    // atan there, then the result is mirrored into the right octant. Max absolute error 3e-7 (libm: 2.5e-7).
+    // atan2(0, 0) is 0.
+    constexpr float atan2(const float y, const float x)
+    {
+        const auto ax = (x < 0.0f) ? -x : x;
+        const auto ay = (y < 0.0f) ? -y : y;
+        const auto max = (ax < ay) ? ay : ax;
+        const auto min = (ax < ay) ? ax : ay;
+        const auto a = min / select(max == 0.0f, 1.0f, max);
+
+        // atan(a) = pi/4 + atan((a - 1) / (a + 1))
+        const auto is_reduced = a > 0.414213562f;
+        const auto t = select(is_reduced, (a - 1.0f) / (a + 1.0f), a);
+        const auto z = t * t;
+        const auto p = -3.33329491539e-1f + z * (1.99777106478e-1f + z * (-1.38776856032e-1f + z * 8.05374449538e-2f));
+        auto r = select(is_reduced, 0.785398163f, 0.0f) + t + t * z * p;
+
+        r = select(ay > ax, 1.57079637f - r, r);
+        r = select(x < 0.0f, 3.14159274f - r, r);
+        return select(y < 0.0f, -r, r);
+    }
+
+    //  1 / x: an initial guess from the bits of x (off by at most 12%) refined by three Newton steps, each of
+    // which about squares the relative error. Max relative error 1.5e-7 for 1e-35 <= |x| <= 1e35 (division:
+    // 6e-8). Zero gives an infinity of the same sign, like division does.
+    constexpr float reciprocal(const float x)
+    {
+        const auto sign = std::bit_cast<std::uint32_t>(x) & 0x8000'0000u;
+        const auto a = std::bit_cast<float>(std::bit_cast<std::uint32_t>(x) ^ sign);
+        auto r = std::bit_cast<float>(0x7ef3'11c3u - std::bit_cast<std::uint32_t>(a));
+        for (int i = 0; i < 3; ++i)
+            r = r * (2.0f - a * r);
+
+        r = select(a == 0.0f, std::numeric_limits<float>::infinity(), r);
+        return std::bit_cast<float>(std::bit_cast<std::uint32_t>(r) | sign);
+    }
+
+    // The span versions compute the function for every element (out must be at least as large as in)
+    inline void sincos(const std::span<const float> x, const std::span<float> sin, const std::span<float> cos)
+    {
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            const auto [s, c] = sincos(x[i]);
+            sin[i] = s;
+            cos[i] = c;
+        }
+    }
+
+    inline void atan2(const std::span<const float> y, const std::span<const float> x, const std::span<float> out)
+    {
+        for (std::size_t i = 0; i < x.size(); ++i)
+            out[i] = atan2(y[i], x[i]);
+    }
+
+    inline void reciprocal(const std::span<const float> x, const std::span<float> out)
+    {
+        for (std::size_t i = 0; i < x.size(); ++i)
+            out[i] = reciprocal(x[i]);
+    }
+
+    // The scalar policy (see scalar_traits) of floats with the fast functions instead of libm
+    struct traits : scalar_traits<float>
+    {
+        static constexpr float sin(const float x) { return sincos(x).sin; }
+        static constexpr float cos(const float x) { return sincos(x).cos; }
+        static constexpr float atan2(const float y, const float x) { return fast_math::atan2(y, x); }
+        static constexpr float reciprocal(const float x) { return fast_math::reciprocal(x); }
+    };
+}
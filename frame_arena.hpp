@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+//  A resettable bump allocator for per-frame scratch memory (hit buffers, span lists, encoded output...).
+// Everything allocated from the arena is released at once by reset() at the start of the next frame.
+//
+// If a frame needs more memory than the arena holds, the extra allocations are served from separate
+// overflow blocks and the next reset() grows the arena to the high water mark. So after the first
+// frame (or the first frame after a resize) rendering does not touch the heap at all.
+class frame_arena
+{
+public:
+    explicit frame_arena(const std::size_t capacity = 0) { reserve(capacity); }
+
+    //  Allocate space for n objects of type T that lives until the next reset. The objects are left
+    // uninitialized (which is why T is restricted to trivially copyable types), so callers must write
+    // before they read.
+    template <typename T>
+    [[nodiscard]] std::span<T> allocate(const std::size_t n)
+    {
+        static_assert(std::is_trivially_copyable_v<T> and std::is_trivially_destructible_v<T>,
+                      "arena objects are never constructed or destroyed");
+
+        const auto bytes = n * sizeof(T);
+        const auto offset = (used_ + alignof(T) - 1) & ~(alignof(T) - 1);
+        std::byte* p = nullptr;
+        if (offset + bytes <= capacity_)
+        {
+            p = storage_.get() + offset;
+            used_ = offset + bytes;
+        }
+        else
+        {
+            overflow_.push_back(std::make_unique_for_overwrite<std::byte[]>(bytes + alignof(T)));
+            overflow_bytes_ += bytes + alignof(T);
+            p = overflow_.back().get();
+            p += (alignof(T) - reinterpret_cast<std::uintptr_t>(p) % alignof(T)) % alignof(T);
+        }
+
+        return std::span<T>(reinterpret_cast<T*>(p), n);
+    }
+
+    // Release everything that was allocated since the last reset
+    void reset()
+    {
+        if (!overflow_.empty())
+        {
+            const auto high_water_mark = used_ + overflow_bytes_;
+            overflow_.clear();
+            overflow_bytes_ = 0;
+            reserve(high_water_mark);
+        }
+
+        used_ = 0;
+    }
+
+    [[nodiscard]] std::size_t capacity() const { return capacity_; }
+    [[nodiscard]] std::size_t used() const { return used_ + overflow_bytes_; }
+
+private:
+    void reserve(const std::size_t capacity)
+    {
+        if (capacity <= capacity_) return;
+        storage_ = std::make_unique_for_overwrite<std::byte[]>(capacity);
+        capacity_ = capacity;
+    }
+
+    std::unique_ptr<std::byte[]> storage_;
+    std::size_t capacity_ = 0;
+    std::size_t used_ = 0;
+
+    std::vector<std::unique_ptr<std::byte[]>> overflow_;
+    std::size_t overflow_bytes_ = 0;
+};
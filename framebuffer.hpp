@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Attributes of a character cell (combined as bit flags)
+namespace attribute
+{
+    constexpr std::uint8_t none = 0;
+    constexpr std::uint8_t reversed = 1 << 0;
+}
+
+// The colors of character cells: 0 is the default color of the terminal and 1 to num_shades are shades of grey
+// from the brightest to the darkest (see shade_of)
+constexpr int num_shades = 6;
+
+// A single character cell on the screen: the unicode code point that is displayed, its attributes and its color
+struct cell
+{
+    char32_t glyph = U' ';
+    std::uint8_t attributes = attribute::none;
+    std::uint8_t color = 0;
+
+    constexpr bool operator==(const cell&) const = default;
+};
+
+//  The character cells of a whole screen stored row by row. Everything is rendered into a framebuffer
+// first and only then is it encoded and sent to the terminal. Writes outside of the framebuffer are
+// ignored (just as curses ignores writes outside of the screen).
+class framebuffer
+{
+public:
+    framebuffer() = default;
+    framebuffer(const int width, const int height)
+        : width_(std::max(0, width))
+        , height_(std::max(0, height))
+        , cells_(static_cast<std::size_t>(width_) * static_cast<std::size_t>(height_))
+    {
+    }
+
+    [[nodiscard]] int width() const { return width_; }
+    [[nodiscard]] int height() const { return height_; }
+
+    [[nodiscard]] std::span<cell> row(const int y) { return {cells_.data() + index(0, y), size(width_)}; }
+    [[nodiscard]] std::span<const cell> row(const int y) const { return {cells_.data() + index(0, y), size(width_)}; }
+
+    void put(const int x, const int y, const char32_t glyph, const std::uint8_t attributes = attribute::none,
+             const std::uint8_t color = 0)
+    {
+        if ((x >= 0) and (x < width_) and (y >= 0) and (y < height_)) cells_[index(x, y)] = {glyph, attributes, color};
+    }
+
+    // set the cells of column x from row y_begin up to (but excluding) y_end, which must all be inside the
+    // framebuffer (no bounds checks, so that this is a tight loop)
+    void fill_column(const int x, const int y_begin, const int y_end, const cell c)
+    {
+        auto* p = cells_.data() + index(x, y_begin);
+        for (int y = y_begin; y < y_end; ++y, p += width_)
+            *p = c;
+    }
+
+    // set the cells of column x from row y_begin up to y_end to the results of next() (which is called once per
+    // row from the top down), with the same requirements as fill_column
+    template <typename F>
+    void generate_column(const int x, const int y_begin, const int y_end, F&& next)
+    {
+        auto* p = cells_.data() + index(x, y_begin);
+        for (int y = y_begin; y < y_end; ++y, p += width_)
+            *p = next();
+    }
+
+    // print a string starting at the given position (one cell per character)
+    void print(int x, const int y, const wchar_t* s)
+    {
+        for (; *s != L'\0'; ++s, ++x)
+            put(x, y, static_cast<char32_t>(*s));
+    }
+
+    // print a plain ASCII string starting at the given position
+    void print(int x, const int y, const std::string_view s)
+    {
+        for (const auto c : s)
+            put(x++, y, static_cast<char32_t>(c));
+    }
+
+private:
+    static std::size_t size(const int n) { return static_cast<std::size_t>(n); }
+    [[nodiscard]] std::size_t index(const int x, const int y) const { return size(y) * size(width_) + size(x); }
+
+    int width_ = 0;
+    int height_ = 0;
+    std::vector<cell> cells_;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+// Everything that a key press can trigger
+enum class action : std::uint8_t
+{
+    none,
+    turn_left,
+    turn_right,
+    walk_forward,
+    walk_backward,
+    strafe_right,
+    strafe_left,
+    cycle_render_mode,
+    toggle_dither,
+    toggle_floor_casting,
+    toggle_map,
+    cycle_wall_caster,
+    toggle_metrics,
+    quit,
+    count
+};
+
+//  Maps key codes (as returned by getch) to actions using a flat table indexed by key code, so
+// looking up a key is a single bounds check and a load. Key codes outside of the table (including
+// ERR) map to action::none.
+class key_bindings
+{
+public:
+    constexpr key_bindings(const std::initializer_list<std::pair<int, action>> bindings)
+    {
+        for (const auto& [key, a] : bindings)
+            table_[static_cast<std::size_t>(key)] = a;
+    }
+
+    [[nodiscard]] constexpr action operator[](const int key) const
+    {
+        return (key >= 0 and key < table_size) ? table_[static_cast<std::size_t>(key)] : action::none;
+    }
+
+private:
+    // ncurses key codes (including the KEY_* function keys) are all below 512
+    constexpr static int table_size = 512;
+    std::array<action, table_size> table_{};
+};
+
+//  Tracks which actions are currently held. Terminals only report key presses (and the auto-repeats
+// of held keys), never releases. So an action counts as held until no press or repeat has been seen
+// for it for a little while. Multiple actions can be held at the same time (e.g. walk and turn).
+// A held key is only repeated after the repeat delay of the terminal (typically 250 to 500 ms, 660 ms
+// on X11) and then every few tens of milliseconds, so the first press holds an action for the repeat
+// delay and every repeat after that only for repeat_hold_time (or what is left of the hold, if that is
+// longer), which stops the action soon after the key is released.
+class held_actions
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    //  Holding the first press until the first repeat keeps a held key moving without a pause, but a tap would
+    // then move for the whole repeat delay (almost 3 cells at the run speed of the player instead of the half
+    // cell that a key press used to move). So until the first repeat arrives an action only runs at the speed
+    // that moves an isolated tap as far as tap_time at full speed, which makes a held key start slowly.
+    constexpr static auto default_repeat_delay = std::chrono::milliseconds(700);
+    constexpr static auto repeat_hold_time = std::chrono::milliseconds(150);
+    constexpr static auto tap_time = std::chrono::milliseconds(125);
+
+    constexpr explicit held_actions(const clock::duration repeat_delay = default_repeat_delay)
+        : first_hold_time_(std::max<clock::duration>(repeat_delay, tap_time))
+        , first_press_speed_(std::chrono::duration<float>(tap_time) / first_hold_time_)
+    {
+    }
+
+    constexpr void press(const action a, const clock::time_point t)
+    {
+        auto& hold = holds_[index(a)];
+        if (t < hold.until)
+            hold = {.until = std::max(hold.until, t + clock::duration(repeat_hold_time)), .is_repeated = true};
+        else
+            hold = {.until = t + first_hold_time_, .is_repeated = false};
+    }
+
+    [[nodiscard]] constexpr bool is_held(const action a, const clock::time_point t) const
+    {
+        return t < holds_[index(a)].until;
+    }
+
+    // The fraction of its full speed that an action runs at (zero if it is not held, see default_repeat_delay)
+    [[nodiscard]] constexpr float speed(const action a, const clock::time_point t) const
+    {
+        if (!is_held(a, t)) return 0.0f;
+        return holds_[index(a)].is_repeated ? 1.0f : first_press_speed_;
+    }
+
+private:
+    struct hold
+    {
+        clock::time_point until;
+        bool is_repeated = false;  // whether the key has been repeated since the first press
+    };
+
+    constexpr static std::size_t index(const action a) { return static_cast<std::size_t>(a); }
+
+    clock::duration first_hold_time_;
+    float first_press_speed_;
+    std::array<hold, static_cast<std::size_t>(action::count)> holds_{};
+};
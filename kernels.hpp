@@ -0,0 +1,157 @@
+#pragma once
+
+#include <encoder.hpp>
+#include <frame_arena.hpp>
+#include <framebuffer.hpp>
+#include <map.hpp>
+#include <raycaster.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+//  Runtime CPU dispatch for the hot kernels (casting the rays through the maze and diffing and encoding
+// frames). The build targets the baseline instruction set, so that one binary runs everywhere, and each
+// kernel is compiled once more for AVX2 and once for AVX-512 by wrappers with a target attribute that
+// inline everything they call (flatten). The best version that the CPU supports is picked at startup
+// (and can be overridden). Dispatch is only available on x86 with GCC or Clang, elsewhere there is only
+// the baseline.
+//
+// FMA is deliberately not enabled for AVX2, and AVX-512 (which implies FMA) relies on the build turning off
+// floating point contraction (see CMakeLists.txt): fusing multiplies and adds would change the rounding and
+// all versions are supposed to render exactly the same frames.
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define WSTERM_ISA_DISPATCH 1
+#else
+#define WSTERM_ISA_DISPATCH 0
+#endif
+
+// The instruction sets that the kernels are compiled for
+enum class isa : std::uint8_t
+{
+    baseline,  // SSE2 on x86-64
+    avx2,
+    avx512
+};
+
+constexpr std::string_view isa_name(const isa i)
+{
+    switch (i)
+    {
+    case isa::avx2: return "avx2";
+    case isa::avx512: return "avx512";
+    default: return WSTERM_ISA_DISPATCH ? "sse2" : "baseline";
+    }
+}
+
+// The instruction set with the given name (baseline for anything unknown)
+constexpr isa parse_isa(const std::string_view name)
+{
+    if (name == "avx512") return isa::avx512;
+    if (name == "avx2") return isa::avx2;
+    return isa::baseline;
+}
+
+// The best instruction set that the CPU supports (and that there are kernels for)
+inline isa detect_isa()
+{
+#if WSTERM_ISA_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512bw")) return isa::avx512;
+    if (__builtin_cpu_supports("avx2")) return isa::avx2;
+#endif
+    return isa::baseline;
+}
+
+// The kernels compiled for one instruction set
+struct render_kernels
+{
+    // compute the wall hits in the built-in maze (see compute_wall_hits), the ray of column i is
+    // cam.ray(ray_offsets[i])
+    ray_stats (*compute_maze_wall_hits)(std::span<wall_hit> hits, const camera& cam,
+                                        std::span<const float> ray_offsets, std::size_t span_width,
+                                        std::size_t column_step, const ray_limits& limits,
+                                        const ray_options& options);
+
+    // see encode_changes
+    encoded_frame (*encode_changes)(const framebuffer& frame, const framebuffer& previous, frame_arena& arena);
+};
+
+namespace kernels
+{
+    inline ray_stats compute_maze_wall_hits_baseline(const std::span<wall_hit> hits, const camera& cam,
+                                                     const std::span<const float> ray_offsets,
+                                                     const std::size_t span_width, const std::size_t column_step,
+                                                     const ray_limits& limits, const ray_options& options)
+    {
+        const auto ray_dir = [&](const std::size_t i) { return cam.ray(ray_offsets[i]); };
+        return ::compute_wall_hits(maze_map{}, hits, cam.pos, ray_dir, span_width, column_step, limits, options);
+    }
+
+    inline encoded_frame encode_changes_baseline(const framebuffer& frame, const framebuffer& previous,
+                                                 frame_arena& arena)
+    {
+        return ::encode_changes(frame, previous, arena);
+    }
+
+#if WSTERM_ISA_DISPATCH
+    [[gnu::target("avx2"), gnu::flatten]] inline ray_stats
+    compute_maze_wall_hits_avx2(const std::span<wall_hit> hits, const camera& cam,
+                                const std::span<const float> ray_offsets, const std::size_t span_width,
+                                const std::size_t column_step, const ray_limits& limits, const ray_options& options)
+    {
+        return compute_maze_wall_hits_baseline(hits, cam, ray_offsets, span_width, column_step, limits, options);
+    }
+
+    [[gnu::target("avx2"), gnu::flatten]] inline encoded_frame
+    encode_changes_avx2(const framebuffer& frame, const framebuffer& previous, frame_arena& arena)
+    {
+        return encode_changes_baseline(frame, previous, arena);
+    }
+
+    [[gnu::target("avx512f,avx512bw,avx512vl"), gnu::flatten]] inline ray_stats
+    compute_maze_wall_hits_avx512(const std::span<wall_hit> hits, const camera& cam,
+                                  const std::span<const float> ray_offsets, const std::size_t span_width,
+                                  const std::size_t column_step, const ray_limits& limits, const ray_options& options)
+    {
+        return compute_maze_wall_hits_baseline(hits, cam, ray_offsets, span_width, column_step, limits, options);
+    }
+
+    [[gnu::target("avx512f,avx512bw,avx512vl"), gnu::flatten]] inline encoded_frame
+    encode_changes_avx512(const framebuffer& frame, const framebuffer& previous, frame_arena& arena)
+    {
+        return encode_changes_baseline(frame, previous, arena);
+    }
+#endif
+}
+
+// The kernels for the given instruction set (which the CPU must support)
+inline const render_kernels& kernels_for(const isa i)
+{
+    static constexpr auto baseline =
+        render_kernels{kernels::compute_maze_wall_hits_baseline, kernels::encode_changes_baseline};
+#if WSTERM_ISA_DISPATCH
+    static constexpr auto avx2 = render_kernels{kernels::compute_maze_wall_hits_avx2, kernels::encode_changes_avx2};
+    static constexpr auto avx512 =
+        render_kernels{kernels::compute_maze_wall_hits_avx512, kernels::encode_changes_avx512};
+    switch (i)
+    {
+    case isa::avx2: return avx2;
+    case isa::avx512: return avx512;
+    default: return baseline;
+    }
+#else
+    static_cast<void>(i);
+    return baseline;
+#endif
+}
+
+// Pick the instruction set to use: the requested one if the CPU supports it, otherwise the best one it does
+inline isa select_isa(const std::string_view requested = {})
+{
+    const auto best = detect_isa();
+    const auto wanted = requested.empty() ? best : parse_isa(requested);
+    return (wanted <= best) ? wanted : best;
+}
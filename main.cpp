@@ -1,309 +1,252 @@
-#include <math.hpp>
+#include <input.hpp>
+#include <player.hpp>
+#include <renderer.hpp>
+#include <resolution_controller.hpp>
 #include <terminal.hpp>
+#include <triple_buffer.hpp>
 
 #include <algorithm>
 #include <array>
-#include <functional>
-#include <ranges>
-
-// clang-format off
-constexpr auto maze_height = 20;
-constexpr auto maze = std::array<const wchar_t*, maze_height>{
-    L"+++++++++++++++++++++",
-    L"+                   +",
-    L"+              ++++ +",
-    L"+      +++++     ++ +",
-    L"+      +++++     +  +",
-    L"+      +++++   +++ ++",
-    L"+      +++++   +    +",
-    L"+      +++++   + ++++",
-    L"+              + ++++",
-    L"+                   +",
-    L"+                   +",
-    L"+++++ ++++++ ++++++ +",
-    L"+++++ ++++++ ++++++ +",
-    L"+                   +",
-    L"+               +   +",
-    L"+     +             +",
-    L"+  +           +    +",
-    L"+      +   +        +",
-    L"+                +  +",
-    L"+++++++++++++++++++++",
-};
-// clang-format on
-
-constexpr auto is_wall(const vec2i& pos) { return maze[pos.y][pos.x] == L'+'; }
-constexpr auto is_wall(const vec2f& pos) { return is_wall(to_vec2i(pos)); }
-
-//  The coordinates of each position/vector in the dda algorithm can be represented
-// by the grid coordinate (i.e. snapped to integer value) and the accompanying distance
-// along the ray that is being cast.
-struct dda_coord
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <optional>
+#include <string_view>
+#include <thread>
+
+// Everything the renderer needs to know about the simulated world. The simulation thread publishes
+// an immutable copy of this every tick so that rendering never reads state that is being mutated.
+// The previous state is included so that the renderer can interpolate between the two ticks.
+struct world_snapshot
 {
-    int on_grid;
-    float distance;
+    player previous;
+    player current;
+    std::chrono::steady_clock::time_point time;  // the time at which current is valid
 
-    // Two dda coordinates can be added simply by adding their value on the grid and
-    // adding the distances along the ray
-    constexpr dda_coord& operator+=(const dda_coord& other)
+    // The player as it would be at the given time, assuming that the next tick follows `tick` after
+    // this one. Rendering is therefore one tick behind the simulation, but moves smoothly.
+    [[nodiscard]] player at(const std::chrono::steady_clock::time_point t, const std::chrono::microseconds tick) const
     {
-        on_grid += other.on_grid;
-        distance += other.distance;
-        return *this;
+        const auto alpha = std::chrono::duration<float>(t - time) / tick;
+        return lerp(previous, current, std::clamp(alpha, 0.0f, 1.0f));
     }
 };
 
-//  To cast a ray we start with the initial x and y coordinates and the step in x and y
-// respectively. As long as the distance along the ray in the x-direction is shorter
-// than that travelled in the y direction, then we increment x by the x-step. Otherwise
-// we increment y by the y-step. When we hit a wall, we're finished.
-//
-// Note: we're assuming a closed map here to ensure that the ray actually hits something
-// and the while loop terminates.
-constexpr auto cast_ray(dda_coord x, dda_coord y, const dda_coord& x_step, const dda_coord& y_step)
-{
-    auto is_x_step = false;
-    while (!is_wall(vec2i{x.on_grid, y.on_grid}))
-    {
-        is_x_step = x.distance < y.distance;
-        if (is_x_step)
-            x += x_step;
-        else
-            y += y_step;
-    }
+// The simulation runs at a fixed rate with a fixed time step, independent of the render frame rate
+constexpr auto simulation_tick = std::chrono::microseconds(1'000'000 / 60);
 
-    // the result is whether the ray hit a wall while taking an x step and the grid coordinate
-    // of the cell that was hit
-    return std::pair(is_x_step, static_cast<float>(is_x_step ? x.on_grid : y.on_grid));
-}
-
-// Compute the start and step for a given x or y direction. Arguments are a coordinate (either
-// x or y) of the camera position and the corresponding component of the ray direction.
-constexpr auto initialize_dda_direction(const float pos, const float dir)
-{
-    const auto grid_pos = static_cast<int>(pos);
-
-    // Step on grid is -1 or 1 depending on ray direction. Step distance along ray is the distance
-    // travelled along the ray if we cross a cell in this direction (resolves nicely to |1/dir|).
-    const auto step = dda_coord{.on_grid = (dir < 0.0f) ? -1 : 1, .distance = std::abs(1.0f / dir)};
-
-    // Start on grid is the position of the camera snapped on to the grid. Start distance is the
-    // distance travelled along the ray in order to reach the edge of the current cell that corresponds
-    // to this direction (horizontal for x arguments, vertical for y arguments).
-    const auto aligned_edge_offset = (dir < 0.0f) ? (pos - grid_pos) : (grid_pos + 1.0f - pos);
-    const auto start = dda_coord{.on_grid = grid_pos, .distance = step.distance * aligned_edge_offset};
-    return std::pair(start, step);
-}
+// Key presses are read and translated into actions on the render thread (ncurses is not thread safe).
+// Actions that affect the simulation are forwarded to the simulation thread through this queue.
+using action_queue = spsc_ring<action, 64>;
 
-// A wall hit is a distance from the camera to the wall and the texture coordinate in x (which
-// we use to determine whether the ray is hitting the left or right edge of a wall so that
-// we can visually delimit the walls when rendering)
-struct wall_hit
-{
-    float distance = 0.0f;
-    float tx = 0.0f;
+// The key bindings for all actions
+constexpr auto bindings = key_bindings{
+    {'a', action::turn_left},     {'d', action::turn_right},  {'w', action::walk_forward},
+    {'s', action::walk_backward}, {'m', action::strafe_right}, {'n', action::strafe_left},
+    {'h', action::cycle_render_mode}, {'p', action::toggle_map},   {'b', action::cycle_wall_caster},
+    {'i', action::toggle_metrics}, {'g', action::toggle_dither}, {'f', action::toggle_floor_casting},
+    {os::escape_key, action::quit},
 };
 
-// Given a start position and a ray direction from that position compute the wall hit
-constexpr wall_hit compute_wall_hit(const vec2f& pos, const vec2f& dir)
-{
-    const auto [x_start, x_step] = initialize_dda_direction(pos.x, dir.x);
-    const auto [y_start, y_step] = initialize_dda_direction(pos.y, dir.y);
-
-    const auto [is_x, hit_pos] = cast_ray(x_start, y_start, x_step, y_step);
-
-    // Say we ended up hitting a wall while stepping in x, then we compute how far
-    // we had to cast the ray in the x-direction (which is the hit pos minus the
-    // start pos - but we have to correct for the snapped pos being in one
-    // corner of the cell: if we were travelling in the negative direction, then
-    // we hit the wall at the end of a step rather than at the beginning of the
-    // step so our hit pos is actually one too far. ((1 - step) >> 1) is just one
-    // if step is negative and other wise zero). Once we have the distance
-    // traversed in the given direction, then we just divide by the corresponding
-    // component of the direction vector to get the distance (see also how the
-    // start distance was calculated).
-    const auto distance = is_x ? (hit_pos - pos.x + ((1 - x_step.on_grid) >> 1)) / dir.x
-                               : (hit_pos - pos.y + ((1 - y_step.on_grid) >> 1)) / dir.y;
-
-    // if we hit in the x direction then the tex coord is the fractional component
-    // of the y coordinate of the point where the ray hits the wall. And vice versa
-    // if we hit in the y direction.
-    const auto tx = is_x ? pos.y + distance * dir.y : pos.x + distance * dir.x;
-    return {distance, tx - std::floor(tx)};
-}
-
-// For a given fraction (i.e. x in [0, 1]) return the character that best represents that
-// fraction of a whole block (used to generate the smoothing effect on the top and bottom
-// of walls)
-constexpr const char* fractional_block(const float x)
+// Advance the player by dt seconds according to a held movement action
+constexpr void apply(player& plyr, const action a, const float dt)
 {
-    constexpr auto chars = std::array{" ", "\u2581", "\u2582", "\u2583", "\u2584", "\u2585", "\u2586", "\u2587"};
-    const auto index = static_cast<int>(x * (chars.size() - 1e-6f));
-    return chars[index];
-}
-
-// given the screen height and the corresponding wall hit, draw a column of characters representing
-// the ceiling, wall and floor that are visible in that column. Note that this could be simplified
-// if we always smoothed the edges and did not bother with the blocky mode, but for comparison
-// purposes the smoothing can be turned on and off.
-void draw_column(const os::terminal& term, const int x, const int screen_height, const wall_hit hit,
-                 const bool is_blocky)
-{
-    // The floating point height of the wall projected into screen space
-    const auto exact_wall_height = static_cast<float>(screen_height) / hit.distance;
-
-    // The number of whole characters that would be needed to represent the wall. If we're
-    // smoothing the edges then the number of whole chars is always even because an odd
-    // truncated wall height is achieved using an even number of whole blocks with a half
-    // block on the top and the bottom (that way the walls are always centered correctly)
-    const auto truncated_wall_height = static_cast<int>(exact_wall_height);
-    const auto num_whole_chars = truncated_wall_height - (is_blocky ? 0 : (truncated_wall_height % 2));
-
-    // The y-coordinate (or row position within the column) of the top and bottom of the wall.
-    // This is where the fractional blocks will go if we're smoothing the edges
-    const auto wall_top = ((screen_height - num_whole_chars) / 2) - 1;
-    const auto wall_bottom = wall_top + num_whole_chars + 2;
-
-    // Where the sequence of wall and floor chars start (add one if we're smoothing the edges
-    // to make space for the fractional blocks)
-    const auto wall_start = wall_top + (is_blocky ? 0 : 1);
-    const auto floor_start = wall_bottom + (is_blocky ? 0 : 1);
-
-    // anything on the left or right edge of a wall cell is rendered using a different character
-    // (wall chars are rendered with the invert flag set to true so " " is actually a solid block)
-    const auto wall_char = ((hit.tx < 0.1f) or (hit.tx > 0.9)) ? "\u2502" : " ";
-
-    // the range of y coordinates between min and max, clamped to the screen and empty if max < min
-    const auto block_between = [&](int min, int max) {
-        min = std::max(0, min);
-        max = std::min(screen_height, max);
-        return std::ranges::iota_view(std::min(min, max), max);
-    };
-
-    // print a (possibly inverted) character to the current column
-    const auto print = [&](const char* c, const bool invert = false) {
-        return [&, c, invert](const int y) { term.print_char(x, y, c, invert); };
-    };
-
-    // render the ceiling, wall and floor characters respectively
-    std::ranges::for_each(block_between(0, wall_top), print(" "));
-    std::ranges::for_each(block_between(wall_start, wall_bottom), print(wall_char, true));
-    std::ranges::for_each(block_between(floor_start, screen_height), print("."));
-
-    // if we're smoothing the edges and the edges are on the screen, then print the fractional blocks
-    if (!is_blocky and (wall_top >= 0))
+    switch (a)
     {
-        // split the left over bit of the wall height after rendering the whole blocks over
-        // the top and bottom fractional blocks
-        const auto fraction = 0.5f * (exact_wall_height - static_cast<float>(num_whole_chars));
-        print(fractional_block(fraction))(wall_top);
-        print(fractional_block(1.0f - fraction), true)(wall_bottom);
+    case action::turn_left: return plyr.turn(1.0f, dt);
+    case action::turn_right: return plyr.turn(-1.0f, dt);
+    case action::walk_forward: return plyr.walk(1.0f, dt);
+    case action::walk_backward: return plyr.walk(-1.0f, dt);
+    case action::strafe_right: return plyr.strafe(1.0f, dt);
+    case action::strafe_left: return plyr.strafe(-1.0f, dt);
+    default: return;
     }
 }
 
-// Represent a player by the position, the forward direction unit vector and a second unit
-// vector, perpendicular to the forward vector, pointing to the right of the player that
-// is used both for strafing and computing the (non-unit) ray direction vectors
-class player
+// Run the simulation at a fixed rate until stop is requested. Each tick picks up all pending actions,
+// advances the player by one fixed time step for every action that is held and publishes the resulting
+// state for the renderer. If the thread falls behind, it runs ticks back to back until it has caught up.
+void simulate(const std::stop_token& stop, action_queue& actions, triple_buffer<world_snapshot>& snapshots,
+              const held_actions::clock::duration repeat_delay)
 {
-public:
-    [[nodiscard]] constexpr vec2f pos() const { return pos_; }
+    using clock = std::chrono::steady_clock;
+    constexpr auto dt = std::chrono::duration<float>(simulation_tick).count();
+    constexpr auto movements = std::array{action::turn_left,     action::turn_right,   action::walk_forward,
+                                          action::walk_backward, action::strafe_right, action::strafe_left};
 
-    // Imagine a screen one unit in front of the player, parallel to the right pointing
-    // vector, with coordinates starting at the very left of the screen at zero and
-    // ending at the very right of the screen at one. If you pass in a screen
-    // coordinate between zero and one, this function returns a vector that starts
-    // at the player position and ends at the corresponding point on the imagined
-    // screen. Note that only at 0.5 - i.e. the center of the screen - will this
-    // be a unit vector.
-    [[nodiscard]] constexpr vec2f line_of_sight(const float normalized_screen_x) const
-    {
-        const auto increment = (2.0f * normalized_screen_x) - 1.0f;
-        return forward_ + right_ * increment;
-    }
-
-    constexpr void walk(const float factor) { move(forward_ * factor * run_speed); }
-    constexpr void strafe(const float factor) { move(right_ * factor * run_speed); }
-    constexpr void turn(const float factor)
-    {
-        forward_ = rotate(forward_, factor * turn_speed);
-        right_ = rotate(right_, factor * turn_speed);
-    }
+    auto plyr = player{};
+    auto held = held_actions(repeat_delay);
 
-private:
-    constexpr void move(const vec2f& v)
+    for (auto next_tick = clock::now(); !stop.stop_requested(); next_tick += simulation_tick)
     {
-        const auto p = pos_ + v;
-        if (!is_wall(p)) pos_ = p;  // very primitive collision detection
-    }
+        std::this_thread::sleep_until(next_tick);
 
-    vec2f pos_ = vec2f{.x = 5.0f, .y = 5.0f};
-    vec2f forward_ = vec2f{.x = 0.0f, .y = 1.0f};
-    vec2f right_ = vec2f{.x = 0.8f, .y = 0.0f};
+        for (auto a = action::none; actions.pop(a);)
+            held.press(a, next_tick);
 
-    constexpr static float run_speed = 0.5f;
-    constexpr static float turn_speed = 0.1f;
-};
+        const auto previous = plyr;
+        for (const auto a : movements)
+            if (const auto speed = held.speed(a, next_tick); speed > 0.0f) apply(plyr, a, speed * dt);
 
-// Draw the 3D scene
-void draw_scene(const os::terminal& term, const int screen_width, const int screen_height, const player& plyr,
-                const bool is_blocky)
-{
-    // For each screen column, get the ray direction, compute the wall hit and draw the column
-    for (int i = 0; i < screen_width; ++i)
-    {
-        const auto ray_dir = plyr.line_of_sight(static_cast<float>(i) / static_cast<float>(screen_width - 1));
-        draw_column(term, i, screen_height, compute_wall_hit(plyr.pos(), ray_dir), is_blocky);
+        snapshots.back() = world_snapshot{.previous = previous, .current = plyr, .time = next_tick};
+        snapshots.publish();
     }
 }
 
-void draw_map(const os::terminal& term, const player& plyr)
+// The value of a command line option that must be a positive (and finite) number, or nothing (with a warning) if
+// the text is anything else
+template <typename T>
+std::optional<T> parse_positive(const char* name, const char* text)
 {
-    // print each line of the map
-    for (auto i = maze_height; const auto line : maze)
-        term.print(0, --i, line);
-
-    // print the player on the map as a small arrow pointing in the direction that the player
-    // is looking
-    const auto [x, y] = to_vec2i(plyr.pos());
-    const auto dir = (pi / 16.0f) + (to_radians(plyr.line_of_sight(0.5f)) / (pi * 2.0f));
-    const auto dir_index = (7 + static_cast<int>(dir * 8.0f)) % 8;
-    constexpr auto dir_chars =
-        std::array{"\u25c0", "\u25e3", "\u25bc", "\u25e2", "\u25b6", "\u25e5", "\u25b2", "\u25e4"};
-    term.print_char(x, maze_height - y - 1, dir_chars[dir_index]);
-}
+    auto value = T{};
+    const auto end = text + std::strlen(text);
+    const auto [last, error] = std::from_chars(text, end, value);
+    if ((error == std::errc{}) and (last == end) and std::isfinite(value) and (value > T{0})) return value;
 
-// render the scene (and possibly the map) to the terminal
-void render(os::terminal& term, const player& plyr, bool is_blocky, bool is_draw_map)
-{
-    const auto [screen_width, screen_height] = term.screen_size();
-    draw_scene(term, screen_width, screen_height, plyr, is_blocky);
-    if (is_draw_map) draw_map(term, plyr);
+    std::fprintf(stderr, "wsterm: ignoring the %s %s (it must be a positive number)\n", name, text);
+    return std::nullopt;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    auto term = os::terminal{};
+    // variable settings
+    auto settings = render_settings{};
+    bool is_running = true;
+
+    // command line options: --frame-time <ms> sets the frame time that the dynamic resolution aims for,
+    // --ray-budget <ms> the time the progressive wall caster may spend on computing wall hits and
+    // --far-plane <distance> and --max-steps <n> limit how far rays go (with fog towards the far plane) and
+    // --lut-cache <path> is where the lookup table of the table wall caster is saved and loaded from and
+    // --isa <sse2|avx2|avx512> overrides the instruction set of the kernels (if the CPU supports it) and
+    // --dda <branch|select|unrolled> selects how rays step through the map and --math fast computes the ray
+    // step distances with the fast approximate reciprocal instead of a division and
+    // --mode <smooth|blocky|braille|shaded|textured> is the rendering mode to start with and --texture <path> is
+    // the texture file of textured walls (see wall_texture) and --sprites <n> scatters n sprites over the maze and
+    // --repeat-delay <ms> is how long a key press holds its movement before the terminal repeats the key
+    auto target_frame_time = resolution_controller::milliseconds(1000.0f / 60.0f);
+    const char* lut_cache = nullptr;
+    auto requested_isa = std::string_view{};
+    auto texture = std::optional<wall_texture>{};
+    auto num_sprites = std::size_t{0};
+    auto repeat_delay = held_actions::clock::duration(held_actions::default_repeat_delay);
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        const auto option = std::string_view(argv[i]);
+        if (option == "--frame-time")
+        {
+            if (const auto ms = parse_positive<float>("frame time", argv[++i]))
+                target_frame_time = resolution_controller::milliseconds(*ms);
+        }
+        else if (option == "--ray-budget")
+        {
+            if (const auto ms = parse_positive<float>("ray budget", argv[++i]))
+                settings.ray_budget = resolution_controller::milliseconds(*ms);
+        }
+        else if (option == "--far-plane")
+        {
+            if (const auto distance = parse_positive<float>("far plane", argv[++i]))
+                settings.limits.max_distance = *distance;
+        }
+        else if (option == "--max-steps")
+        {
+            if (const auto steps = parse_positive<int>("maximum number of steps", argv[++i]))
+                settings.limits.max_steps = *steps;
+        }
+        else if (option == "--lut-cache")
+            lut_cache = argv[++i];
+        else if (option == "--isa")
+            requested_isa = argv[++i];
+        else if (option == "--dda")
+            settings.casting.stepping = parse_dda_stepping(argv[++i]);
+        else if (option == "--math")
+            settings.casting.is_fast_math = (std::string_view(argv[++i]) == "fast");
+        else if (option == "--mode")
+            settings.mode = parse_render_mode(argv[++i]);
+        else if (option == "--texture")
+        {
+            texture = wall_texture::load(argv[++i]);
+            if (!texture) std::fprintf(stderr, "wsterm: could not load the texture %s\n", argv[i]);
+        }
+        else if (option == "--sprites")
+            num_sprites = std::strtoul(argv[++i], nullptr, 10);
+        else if (option == "--repeat-delay")
+            repeat_delay = std::chrono::milliseconds(std::max(std::atoi(argv[++i]), 0));
+    }
+    if (texture) settings.texture = &*texture;
 
-    auto plyr = player{};
+    const auto sprites = sprite_grid(maze_map{}, scatter_sprites(maze_map{}, num_sprites));
+    if (sprites.size() > 0) settings.sprites = &sprites;
 
-    // variable settings
-    bool is_blocky = false;
-    bool is_map_visible = false;
+    settings.kernel_isa = select_isa(requested_isa);
+    std::fprintf(stderr, "wsterm: using %s kernels (the CPU supports up to %s)\n", isa_name(settings.kernel_isa).data(),
+                 isa_name(detect_isa()).data());
 
-    // Events are a key and a function to execute when that key is pressed
-    using event = std::pair<int, std::function<void()>>;
-    const auto events = std::array{
-        event{'a', [&] { plyr.turn(1.0f); }},         event{'d', [&] { plyr.turn(-1.0f); }},
-        event{'w', [&] { plyr.walk(1.0f); }},         event{'s', [&] { plyr.walk(-1.0f); }},
-        event{'m', [&] { plyr.strafe(1.0f); }},       event{'n', [&] { plyr.strafe(-1.0f); }},
-        event{'h', [&] { is_blocky = !is_blocky; }},  event{'p', [&] { is_map_visible = !is_map_visible; }},
-        event{os::escape_key, [&] { std::exit(0); }},
-    };
+    auto term = os::terminal{};
 
-    while (true)
+    auto actions = action_queue{};
+    auto snapshots = triple_buffer<world_snapshot>{};
+    auto simulation =
+        std::jthread([&](const std::stop_token& stop) { simulate(stop, actions, snapshots, repeat_delay); });
+
+    auto screen = screen_buffers(term.screen_size());
+    auto arena = frame_arena{};
+    auto resolution = resolution_controller(target_frame_time);
+    // the lookup table of the table wall caster is built (or loaded) in the background the first time that wall
+    // caster is picked, since building it takes a few hundred milliseconds and tens of megabytes. Until it is ready
+    // the table wall caster casts every ray.
+    auto table = std::optional<wall_hit_table>{};
+    auto table_builder = std::future<wall_hit_table>{};
+    auto frame_start = std::chrono::steady_clock::now();
+
+    while (is_running)
     {
-        render(term, plyr, is_blocky, is_map_visible);
-        if (const auto it = std::ranges::find(events, getch(), &event::first); it != events.end()) it->second();
+        // the time the last frame took (including sending it to the terminal) drives the dynamic resolution
+        const auto now = std::chrono::steady_clock::now();
+        const auto frame_time = resolution_controller::milliseconds(now - frame_start);
+        frame_start = now;
+        settings.column_step = resolution.update(frame_time);
+
+        arena.reset();
+        if (term.poll_resize()) screen = screen_buffers(term.screen_size());
+        if ((settings.caster == wall_caster::table) and !table and !table_builder.valid())
+        {
+            table_builder = std::async(std::launch::async, [lut_cache] {
+                return wall_hit_table::load_or_build(maze_map{}, lut_cache);
+            });
+        }
+        if (table_builder.valid() and (table_builder.wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+        {
+            table = table_builder.get();
+            settings.table = &*table;
+        }
+
+        // render into the frame buffer and only send what changed since the last frame to the terminal
+        const auto plyr = snapshots.latest().at(now, simulation_tick);
+        const auto stats = render(screen, plyr, settings, arena);
+        if (settings.is_metrics_visible) draw_metrics(screen.frame, frame_time.count(), stats);
+        term.draw(kernels_for(settings.kernel_isa).encode_changes(screen.frame, screen.presented, arena).runs);
+        std::swap(screen.frame, screen.presented);
+
+        // drain all keys that arrived since the last frame. Render settings are handled here, everything
+        // else is forwarded to the simulation
+        for (auto key = getch(); key != ERR; key = getch())
+        {
+            switch (const auto a = bindings[key])
+            {
+            case action::none: break;
+            case action::cycle_render_mode: settings.mode = next(settings.mode); break;
+            case action::toggle_dither: settings.is_dithered = !settings.is_dithered; break;
+            case action::toggle_floor_casting: settings.is_floor_cast = !settings.is_floor_cast; break;
+            case action::toggle_map: settings.is_map_visible = !settings.is_map_visible; break;
+            case action::toggle_metrics: settings.is_metrics_visible = !settings.is_metrics_visible; break;
+            case action::cycle_wall_caster: settings.caster = next(settings.caster); break;
+            case action::quit: is_running = false; break;
+            default: actions.push(a); break;
+            }
+        }
     }
 }
@@ -0,0 +1,344 @@
+#pragma once
+
+#include <math.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// clang-format off
+constexpr auto maze_height = 20;
+constexpr auto maze = std::array<const wchar_t*, maze_height>{
+    L"+++++++++++++++++++++",
+    L"+                   +",
+    L"+              ++++ +",
+    L"+      +++++     ++ +",
+    L"+      +++++     +  +",
+    L"+      +++++   +++ ++",
+    L"+      +++++   +    +",
+    L"+      +++++   + ++++",
+    L"+              + ++++",
+    L"+                   +",
+    L"+                   +",
+    L"+++++ ++++++ ++++++ +",
+    L"+++++ ++++++ ++++++ +",
+    L"+                   +",
+    L"+               +   +",
+    L"+     +             +",
+    L"+  +           +    +",
+    L"+      +   +        +",
+    L"+                +  +",
+    L"+++++++++++++++++++++",
+};
+// clang-format on
+
+//  Maps baked at compile time from string literals (like the maze above): an occupancy grid with one bit per
+// cell (a row is a run of 64 bit words) plus a distance field that holds the distance of every cell to the
+// closest wall, counting diagonal steps as one (i.e. in the Chebyshev metric; 0 for walls), so that every
+// cell within distance(pos) - 1 of pos is known to be open. Baking a map checks the assumptions that the
+// raycaster depends on (see bake_map).
+template <int Width, int Height>
+class baked_map
+{
+public:
+    static constexpr int words_per_row = (Width + 63) / 64;
+
+    [[nodiscard]] constexpr int width() const { return Width; }
+    [[nodiscard]] constexpr int height() const { return Height; }
+
+    [[nodiscard]] constexpr bool is_wall(const vec2i& pos) const
+    {
+        return ((bits_[word_index(pos)] >> (pos.x & 63)) & 1) != 0;
+    }
+
+    [[nodiscard]] constexpr int distance(const vec2i& pos) const { return distances_[cell_index(pos)]; }
+
+    // bake the cells of rows[y][x] (see bake_map)
+    template <typename Rows>
+    static constexpr baked_map from_rows(const Rows& rows, const wchar_t wall)
+    {
+        auto map = baked_map{};
+        for (int y = 0; y < Height; ++y)
+            for (int x = 0; x < Width; ++x)
+                if (rows[y][x] == wall) map.bits_[word_index({x, y})] |= std::uint64_t{1} << (x & 63);
+
+        map.compute_distances();
+        return map;
+    }
+
+private:
+    static constexpr std::size_t word_index(const vec2i& pos)
+    {
+        return static_cast<std::size_t>(pos.y) * words_per_row + static_cast<std::size_t>(pos.x >> 6);
+    }
+
+    static constexpr std::size_t cell_index(const vec2i& pos)
+    {
+        return static_cast<std::size_t>(pos.y) * Width + static_cast<std::size_t>(pos.x);
+    }
+
+    //  The exact Chebyshev distance transform in two passes over the grid (forwards looking at the neighbours
+    // above and to the left, backwards looking at those below and to the right). Cells outside of the map
+    // count as walls, which they are for a closed map anyway.
+    constexpr void compute_distances()
+    {
+        const auto distance_at = [&](const int x, const int y) {
+            const auto is_inside = (x >= 0) and (y >= 0) and (x < Width) and (y < Height);
+            return is_inside ? static_cast<int>(distances_[cell_index({x, y})]) : 0;
+        };
+        const auto relax = [&](const int x, const int y, const int dx, const int dy) {
+            auto& d = distances_[cell_index({x, y})];
+            const auto closest = std::min({distance_at(x - dx, y), distance_at(x - dx, y - dy), distance_at(x, y - dy),
+                                           distance_at(x + dx, y - dy)});
+            d = static_cast<std::uint8_t>(std::min(static_cast<int>(d), closest + 1));
+        };
+
+        for (int y = 0; y < Height; ++y)
+            for (int x = 0; x < Width; ++x)
+                distances_[cell_index({x, y})] = is_wall({x, y}) ? 0 : 255;
+        for (int y = 0; y < Height; ++y)
+            for (int x = 0; x < Width; ++x)
+                relax(x, y, 1, 1);
+        for (int y = Height - 1; y >= 0; --y)
+            for (int x = Width - 1; x >= 0; --x)
+                relax(x, y, -1, -1);
+    }
+
+    std::array<std::uint64_t, static_cast<std::size_t>(words_per_row) * Height> bits_{};
+    std::array<std::uint8_t, static_cast<std::size_t>(Width) * Height> distances_{};
+};
+
+// The length of a row of a map literal
+constexpr int row_length(const wchar_t* row) { return static_cast<int>(std::char_traits<wchar_t>::length(row)); }
+
+// Whether all rows of a map literal have the same length
+template <typename Rows>
+constexpr bool has_uniform_width(const Rows& rows)
+{
+    return std::all_of(std::begin(rows), std::end(rows),
+                       [&](const wchar_t* row) { return row_length(row) == row_length(rows[0]); });
+}
+
+// Whether the border of a map literal (with rows of the same length) is all walls
+template <typename Rows>
+constexpr bool is_closed(const Rows& rows, const wchar_t wall)
+{
+    const auto width = row_length(rows[0]);
+    const auto height = static_cast<int>(std::size(rows));
+    for (int x = 0; x < width; ++x)
+        if ((rows[0][x] != wall) or (rows[height - 1][x] != wall)) return false;
+    for (int y = 0; y < height; ++y)
+        if ((rows[y][0] != wall) or (rows[y][width - 1] != wall)) return false;
+    return true;
+}
+
+//  Bake a map literal (an array of rows, e.g. the maze) at compile time. It doesn't compile unless all rows
+// have the same width and the map is closed, since rays are cast without bounds checks (see cast_ray).
+template <const auto& Rows, wchar_t Wall = L'+'>
+consteval auto bake_map()
+{
+    static_assert(std::size(Rows) > 0, "a map needs at least one row");
+    static_assert(has_uniform_width(Rows), "all rows of a map must have the same width");
+    static_assert(is_closed(Rows, Wall), "a map must be surrounded by walls");
+    constexpr auto width = row_length(Rows[0]);
+    constexpr auto height = static_cast<int>(std::size(Rows));
+    static_assert(width + height < 255, "the distances of a baked map must fit into a byte");
+    return baked_map<width, height>::from_rows(Rows, Wall);
+}
+
+constexpr auto baked_maze = bake_map<maze>();
+
+constexpr auto is_wall(const vec2i& pos) { return baked_maze.is_wall(pos); }
+template <typename T>
+constexpr auto is_wall(const vec2<T>& pos)
+{
+    return is_wall(to_vec2i(pos));
+}
+
+// The built-in maze as a map object. Everything that traverses a map (e.g. the raycaster) works with any
+// type that has an is_wall member for grid coordinates and a width and a height.
+struct maze_map
+{
+    [[nodiscard]] constexpr bool is_wall(const vec2i& pos) const { return baked_maze.is_wall(pos); }
+    [[nodiscard]] constexpr int width() const { return baked_maze.width(); }
+    [[nodiscard]] constexpr int height() const { return baked_maze.height(); }
+    [[nodiscard]] constexpr int distance(const vec2i& pos) const { return baked_maze.distance(pos); }
+};
+
+//  A map of arbitrary size stored as an occupancy grid on the heap (one byte per cell, row by row). The
+// maps are assumed to be closed, so is_wall does not check the bounds.
+class grid_map
+{
+public:
+    grid_map(const int width, const int height)
+        : width_(width)
+        , height_(height)
+        , cells_(static_cast<std::size_t>(width) * static_cast<std::size_t>(height))
+    {
+    }
+
+    // copy any other map (e.g. the built-in maze) into a grid
+    template <typename Map>
+    explicit grid_map(const Map& map)
+        : grid_map(map.width(), map.height())
+    {
+        for (int y = 0; y < height_; ++y)
+            for (int x = 0; x < width_; ++x)
+                set_wall({x, y}, map.is_wall(vec2i{x, y}));
+    }
+
+    [[nodiscard]] int width() const { return width_; }
+    [[nodiscard]] int height() const { return height_; }
+
+    [[nodiscard]] bool is_wall(const vec2i& pos) const { return cells_[index(pos)] != 0; }
+    void set_wall(const vec2i& pos, const bool is_wall) { cells_[index(pos)] = is_wall ? 1 : 0; }
+
+    // the cells row by row (non-zero for walls)
+    [[nodiscard]] const std::uint8_t* data() const { return cells_.data(); }
+
+private:
+    [[nodiscard]] std::size_t index(const vec2i& pos) const
+    {
+        return static_cast<std::size_t>(pos.y) * static_cast<std::size_t>(width_) + static_cast<std::size_t>(pos.x);
+    }
+
+    int width_ = 0;
+    int height_ = 0;
+    std::vector<std::uint8_t> cells_;
+};
+
+//  A map of arbitrary size stored as one bit per cell in 8x8 tiles, so that a tile is a single 64 bit word
+// (row by row within the tile). The tiles in turn are grouped into bricks of 8x8 tiles (64x64 cells, 512
+// bytes) in which they are stored in Morton (Z) order, and the bricks are stored row by row. So cells that
+// are close to each other in any direction are close to each other in memory: a ray that travels in y
+// crosses into the next 64 bit word every eight cells and into the next cache line (which holds a 2x4
+// block of tiles) every 16 or 32 cells instead of jumping a whole row of the map with every step like in
+// a grid_map. Like a grid_map the map is assumed to be closed (is_wall does not check the bounds).
+class tiled_map
+{
+public:
+    constexpr static int tile_size = 8;  // in cells
+
+    tiled_map(const int width, const int height)
+        : width_(width)
+        , height_(height)
+        , bricks_per_row_((width + brick_cells - 1) / brick_cells)
+        , tiles_(static_cast<std::size_t>(bricks_per_row_) *
+                 static_cast<std::size_t>((height + brick_cells - 1) / brick_cells) * tiles_per_brick)
+    {
+    }
+
+    // copy any other map into tiles
+    template <typename Map>
+    explicit tiled_map(const Map& map)
+        : tiled_map(map.width(), map.height())
+    {
+        for (int y = 0; y < height_; ++y)
+            for (int x = 0; x < width_; ++x)
+                if (map.is_wall(vec2i{x, y})) set_wall({x, y}, true);
+    }
+
+    [[nodiscard]] int width() const { return width_; }
+    [[nodiscard]] int height() const { return height_; }
+    [[nodiscard]] std::size_t memory_footprint() const { return tiles_.size() * sizeof(std::uint64_t); }
+
+    [[nodiscard]] bool is_wall(const vec2i& pos) const { return ((tile(tile_of(pos)) >> bit_of(pos)) & 1) != 0; }
+
+    void set_wall(const vec2i& pos, const bool is_wall)
+    {
+        auto& t = tiles_[tile_index(tile_of(pos))];
+        t = is_wall ? (t | (std::uint64_t{1} << bit_of(pos))) : (t & ~(std::uint64_t{1} << bit_of(pos)));
+    }
+
+    // The tile that contains a cell, the tile (i.e. the bit mask of its cells) itself and the bit of a cell in it
+    [[nodiscard]] static constexpr vec2i tile_of(const vec2i& pos) { return {pos.x >> 3, pos.y >> 3}; }
+    [[nodiscard]] std::uint64_t tile(const vec2i& tile_pos) const { return tiles_[tile_index(tile_pos)]; }
+    [[nodiscard]] static constexpr int bit_of(const vec2i& pos) { return ((pos.y & 7) << 3) | (pos.x & 7); }
+
+private:
+    constexpr static int brick_size = 8;  // in tiles
+    constexpr static int brick_cells = brick_size * tile_size;
+    constexpr static std::size_t tiles_per_brick = brick_size * brick_size;
+
+    // interleave the bits of the (three bit) tile coordinates within a brick
+    static constexpr std::size_t morton(const int x, const int y)
+    {
+        const auto spread = [](const int v) {
+            return static_cast<std::size_t>((v & 1) | ((v & 2) << 1) | ((v & 4) << 2));
+        };
+        return spread(x) | (spread(y) << 1);
+    }
+
+    [[nodiscard]] std::size_t tile_index(const vec2i& tile_pos) const
+    {
+        const auto brick = static_cast<std::size_t>(tile_pos.y >> 3) * static_cast<std::size_t>(bricks_per_row_) +
+                           static_cast<std::size_t>(tile_pos.x >> 3);
+        return brick * tiles_per_brick + morton(tile_pos.x & 7, tile_pos.y & 7);
+    }
+
+    int width_ = 0;
+    int height_ = 0;
+    int bricks_per_row_ = 0;
+    std::vector<std::uint64_t> tiles_;
+};
+
+//  Any map (e.g. a grid_map without a wall around it) with everything outside of it being open space. The
+// bounds check is left to this adaptor so that closed maps don't pay for it. Rays cast on an open map must
+// be bounded (see ray_limits), otherwise a ray that leaves the map never stops.
+template <typename Map>
+struct open_map
+{
+    const Map& map;
+
+    [[nodiscard]] constexpr bool is_wall(const vec2i& pos) const
+    {
+        // one unsigned comparison per coordinate also catches the negative ones
+        const auto is_inside = (static_cast<unsigned>(pos.x) < static_cast<unsigned>(map.width())) and
+                               (static_cast<unsigned>(pos.y) < static_cast<unsigned>(map.height()));
+        return is_inside and map.is_wall(pos);
+    }
+
+    [[nodiscard]] constexpr int width() const { return map.width(); }
+    [[nodiscard]] constexpr int height() const { return map.height(); }
+};
+
+//  Generate a closed map of the given size for testing and benchmarking: square rooms with the given
+// room size separated by long straight walls with a doorway in each wall, plus a sprinkling of pillars.
+// The center of every room is always empty.
+inline grid_map generate_map(const int width, const int height, const int room_size = 16,
+                             const std::uint32_t seed = 1)
+{
+    auto map = grid_map(width, height);
+    auto rng = std::mt19937(seed);
+    const auto random = [&](const int n) { return std::uniform_int_distribution(0, n - 1)(rng); };
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const auto is_border = (x == 0) or (y == 0) or (x == width - 1) or (y == height - 1);
+            const auto is_room_wall = ((x % room_size) == 0) or ((y % room_size) == 0);
+            map.set_wall({x, y}, is_border or is_room_wall or (random(100) == 0));
+        }
+    }
+
+    // knock a doorway into each wall between two rooms and clear the room centers
+    for (int y = 0; y + room_size < height; y += room_size)
+    {
+        for (int x = 0; x + room_size < width; x += room_size)
+        {
+            const auto door_x = x + 1 + random(room_size - 2);
+            const auto door_y = y + 1 + random(room_size - 2);
+            if (y > 0) map.set_wall({door_x, y}, false);
+            if (x > 0) map.set_wall({x, door_y}, false);
+            map.set_wall({x + room_size / 2, y + room_size / 2}, false);
+        }
+    }
+
+    return map;
+}
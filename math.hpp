@@ -1,30 +1,412 @@
 #pragma once
 
+#include <array>
+#include <bit>
 #include <cmath>
+#include <compare>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <numbers>
+#include <type_traits>
+
+//  A 16.16 fixed point number (the classic scalar of software raycasters): the range is about ±32768 with
+// the same resolution of 1/65536 everywhere, whereas a float has fewer fractional bits the larger it is
+// (at 32768 there are only 8 left). It converts implicitly from arithmetic types so that it can stand in
+// for float in generic code. Division by zero and results that are out of range saturate, so that the
+// reciprocal of a tiny direction component behaves like an infinite step distance as it does with floats.
+struct fixed
+{
+    static constexpr int fraction_bits = 16;
+    static constexpr std::int64_t one = std::int64_t{1} << fraction_bits;
+
+    std::int32_t raw = 0;
+
+    constexpr fixed() = default;
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    constexpr fixed(const T value)
+        : raw(saturate(static_cast<double>(value) * static_cast<double>(one) + ((value < T{0}) ? -0.5 : 0.5)))
+    {
+    }
+
+    static constexpr fixed from_raw(const std::int32_t raw)
+    {
+        auto result = fixed{};
+        result.raw = raw;
+        return result;
+    }
+
+    static constexpr fixed max() { return from_raw(std::numeric_limits<std::int32_t>::max()); }
+
+    // truncated towards negative infinity (which is the same as for floats for the positive coordinates
+    // on a map)
+    constexpr explicit operator int() const { return raw >> fraction_bits; }
+    constexpr explicit operator float() const { return static_cast<float>(raw) / static_cast<float>(one); }
+    constexpr explicit operator double() const { return static_cast<double>(raw) / static_cast<double>(one); }
+
+    constexpr auto operator<=>(const fixed&) const = default;
+
+    // additions wrap around instead of being undefined (a saturated step distance is never added up)
+    friend constexpr fixed operator+(const fixed a, const fixed b) { return from_raw(wrap(a.raw, b.raw, 1)); }
+    friend constexpr fixed operator-(const fixed a, const fixed b) { return from_raw(wrap(a.raw, b.raw, -1)); }
+    friend constexpr fixed operator-(const fixed a) { return from_raw(wrap(0, a.raw, -1)); }
+    friend constexpr fixed operator*(const fixed a, const fixed b)
+    {
+        return from_raw(saturate((std::int64_t{a.raw} * b.raw) >> fraction_bits));
+    }
+    friend constexpr fixed operator/(const fixed a, const fixed b)
+    {
+        if (b.raw == 0) return (a.raw < 0) ? from_raw(-max().raw) : max();
+        return from_raw(saturate((std::int64_t{a.raw} * one) / b.raw));
+    }
+
+    constexpr fixed& operator+=(const fixed other) { return *this = *this + other; }
+    constexpr fixed& operator-=(const fixed other) { return *this = *this - other; }
+
+private:
+    template <typename T>
+    static constexpr std::int32_t saturate(const T value)
+    {
+        constexpr auto max_raw = std::numeric_limits<std::int32_t>::max();
+        if (!(value < static_cast<T>(max_raw))) return max_raw;  // including NaNs
+        if (value < static_cast<T>(-max_raw)) return -max_raw;
+        return static_cast<std::int32_t>(value);
+    }
+
+    static constexpr std::int32_t wrap(const std::int32_t a, const std::int32_t b, const int sign)
+    {
+        const auto b_bits = static_cast<std::uint32_t>(sign) * static_cast<std::uint32_t>(b);
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(a) + b_bits);
+    }
+};
+
+//  The scalar policy of everything that works with coordinates (vectors, the DDA, the player): float is
+// the default, double is for huge maps (where floats are too coarse far from the origin) and fixed is the
+// integer alternative. This provides what std functions and numeric_limits would provide for floats.
+// Functions that take a Traits parameter can also be given another policy (e.g. fast_math::traits).
+template <typename T>
+struct scalar_traits
+{
+    static constexpr T infinity() { return std::numeric_limits<T>::infinity(); }
+    static constexpr T abs(const T x) { return std::abs(x); }
+    static constexpr T floor(const T x) { return std::floor(x); }
+    static constexpr T sin(const T x) { return std::sin(x); }
+    static constexpr T cos(const T x) { return std::cos(x); }
+    static constexpr T atan2(const T y, const T x) { return std::atan2(y, x); }
+    static constexpr T reciprocal(const T x) { return T{1} / x; }
+};
+
+template <>
+struct scalar_traits<fixed>
+{
+    static constexpr fixed infinity() { return fixed::max(); }
+    static constexpr fixed abs(const fixed x) { return (x.raw < 0) ? -x : x; }
+    static constexpr fixed floor(const fixed x)
+    {
+        return fixed::from_raw(x.raw & ~static_cast<std::int32_t>(fixed::one - 1));
+    }
+
+    // trigonometry is not on any hot path, so it is done in double precision
+    static fixed sin(const fixed x) { return std::sin(static_cast<double>(x)); }
+    static fixed cos(const fixed x) { return std::cos(static_cast<double>(x)); }
+    static fixed atan2(const fixed y, const fixed x)
+    {
+        return std::atan2(static_cast<double>(y), static_cast<double>(x));
+    }
+
+    static constexpr fixed reciprocal(const fixed x) { return fixed{1} / x; }
+};
 
 template <typename T>
 struct vec2
 {
     T x{};
     T y{};
+
+    constexpr bool operator==(const vec2&) const = default;
 };
 
 using vec2i = vec2<int>;
 using vec2f = vec2<float>;
+using vec2d = vec2<double>;
 
-constexpr vec2f operator+(const vec2f& v0, const vec2f& v1) { return {.x = v0.x + v1.x, .y = v0.y + v1.y}; }
-constexpr vec2f operator-(const vec2f& v0, const vec2f& v1) { return {.x = v0.x - v1.x, .y = v0.y - v1.y}; }
-constexpr vec2f operator*(const vec2f& v, const float x) { return {.x = v.x * x, .y = v.y * x}; }
+template <typename T>
+constexpr vec2<T> operator+(const vec2<T>& v0, const vec2<T>& v1)
+{
+    return {.x = v0.x + v1.x, .y = v0.y + v1.y};
+}
+template <typename T>
+constexpr vec2<T> operator-(const vec2<T>& v0, const vec2<T>& v1)
+{
+    return {.x = v0.x - v1.x, .y = v0.y - v1.y};
+}
+// the scalar arguments are not deduced, so that e.g. a vec2d can be scaled by a float
+template <typename T>
+constexpr vec2<T> operator*(const vec2<T>& v, const std::type_identity_t<T> x)
+{
+    return {.x = v.x * x, .y = v.y * x};
+}
 
-constexpr vec2f rotate(const vec2f& v, const float radians)
+template <typename T>
+constexpr vec2<T> lerp(const vec2<T>& v0, const vec2<T>& v1, const std::type_identity_t<T> t)
 {
-    const auto c = std::cos(radians);
-    const auto s = std::sin(radians);
+    return v0 + (v1 - v0) * t;
+}
+
+template <typename T, typename Traits = scalar_traits<T>>
+constexpr vec2<T> rotate(const vec2<T>& v, const std::type_identity_t<T> radians)
+{
+    const auto c = Traits::cos(radians);
+    const auto s = Traits::sin(radians);
     return {.x = v.x * c - v.y * s, .y = v.x * s + v.y * c};
 }
 
-constexpr vec2i to_vec2i(const vec2f& v) { return {.x = static_cast<int>(v.x), .y = static_cast<int>(v.y)}; }
+template <typename T>
+constexpr vec2i to_vec2i(const vec2<T>& v)
+{
+    return {.x = static_cast<int>(v.x), .y = static_cast<int>(v.y)};
+}
+
+// Convert a vector to another scalar type
+template <typename To, typename From>
+constexpr vec2<To> vec2_cast(const vec2<From>& v)
+{
+    return {.x = static_cast<To>(v.x), .y = static_cast<To>(v.y)};
+}
 
 constexpr auto pi = std::numbers::pi_v<float>;
-constexpr auto to_radians(const vec2f& dir) { return pi + std::atan2(dir.y, dir.x); }
+
+template <typename T, typename Traits = scalar_traits<T>>
+constexpr auto to_radians(const vec2<T>& dir)
+{
+    return static_cast<T>(pi) + Traits::atan2(dir.y, dir.x);
+}
+
+//  A pack of N values that are processed together, one per SIMD lane. All operations are loops over the
+// lanes that the compiler vectorizes for whatever instruction set the code is compiled for (a pack wider
+// than the registers takes several of them) without any intrinsics. Gathers are the exception: they stay a
+// load per lane (see compute_wall_hits_packed for what that costs). Since a pack has the
+// full set of arithmetic operators and a scalar policy (see pack_traits), vec2<pack<T, N>> is a pack of
+// vectors that works with the vec2 functions above. Comparisons give a mask for select, any, all and none.
+// Masks are packs of 32 bit integers with either all bits of a lane set or none (like the results of the
+// SIMD compare instructions), so that they are as wide as lanes of float and int and the compiler can keep
+// them in the same registers and turn select into a bitwise blend.
+template <typename T, std::size_t N>
+struct pack;
+
+template <std::size_t N>
+using pack_mask = pack<std::int32_t, N>;
+
+// The lane of a mask for a condition: all bits set if it is true and none otherwise
+constexpr std::int32_t lane_mask(const bool is_set) { return -static_cast<std::int32_t>(is_set); }
+
+template <typename T, std::size_t N>
+struct pack
+{
+    std::array<T, N> lanes{};
+
+    constexpr pack() = default;
+    constexpr pack(const T value) { lanes.fill(value); }  // every lane the same value
+
+    // a pack with lane i set to f(i)
+    template <typename F>
+    static constexpr pack generate(const F& f)
+    {
+        auto result = pack{};
+        for (std::size_t i = 0; i < N; ++i)
+            result.lanes[i] = static_cast<T>(f(i));
+        return result;
+    }
+
+    static constexpr std::size_t size() { return N; }
+
+    constexpr T& operator[](const std::size_t i) { return lanes[i]; }
+    constexpr const T& operator[](const std::size_t i) const { return lanes[i]; }
+
+    template <typename F>
+    friend constexpr auto map_lanes(const pack& a, const F& f)
+    {
+        auto result = pack<decltype(f(a[0])), N>{};
+        for (std::size_t i = 0; i < N; ++i)
+            result[i] = f(a[i]);
+        return result;
+    }
+
+    template <typename F>
+    friend constexpr auto map_lanes(const pack& a, const pack& b, const F& f)
+    {
+        auto result = pack<decltype(f(a[0], b[0])), N>{};
+        for (std::size_t i = 0; i < N; ++i)
+            result[i] = f(a[i], b[i]);
+        return result;
+    }
+
+    friend constexpr pack operator+(const pack& a, const pack& b) { return map_lanes(a, b, std::plus<T>{}); }
+    friend constexpr pack operator-(const pack& a, const pack& b) { return map_lanes(a, b, std::minus<T>{}); }
+    friend constexpr pack operator*(const pack& a, const pack& b) { return map_lanes(a, b, std::multiplies<T>{}); }
+    friend constexpr pack operator/(const pack& a, const pack& b) { return map_lanes(a, b, std::divides<T>{}); }
+    friend constexpr pack operator-(const pack& a) { return map_lanes(a, std::negate<T>{}); }
+    constexpr pack& operator+=(const pack& other) { return *this = *this + other; }
+    constexpr pack& operator-=(const pack& other) { return *this = *this - other; }
+    constexpr pack& operator*=(const pack& other) { return *this = *this * other; }
+
+    // comparisons (and !, which is a comparison with zero) give masks
+    template <typename Compare>
+    static constexpr pack_mask<N> compare(const pack& a, const pack& b, const Compare& c)
+    {
+        return map_lanes(a, b, [&](const T x, const T y) { return lane_mask(c(x, y)); });
+    }
+    friend constexpr pack_mask<N> operator==(const pack& a, const pack& b) { return compare(a, b, std::equal_to{}); }
+    friend constexpr pack_mask<N> operator!=(const pack& a, const pack& b)
+    {
+        return compare(a, b, std::not_equal_to{});
+    }
+    friend constexpr pack_mask<N> operator<(const pack& a, const pack& b) { return compare(a, b, std::less{}); }
+    friend constexpr pack_mask<N> operator<=(const pack& a, const pack& b) { return compare(a, b, std::less_equal{}); }
+    friend constexpr pack_mask<N> operator>(const pack& a, const pack& b) { return compare(a, b, std::greater{}); }
+    friend constexpr pack_mask<N> operator>=(const pack& a, const pack& b)
+    {
+        return compare(a, b, std::greater_equal{});
+    }
+    friend constexpr pack_mask<N> operator!(const pack& a) { return a == pack{}; }
+
+    // the bitwise operators are meant for masks (and packs of integers)
+    friend constexpr pack operator&(const pack& a, const pack& b) { return map_lanes(a, b, std::bit_and<T>{}); }
+    friend constexpr pack operator|(const pack& a, const pack& b) { return map_lanes(a, b, std::bit_or<T>{}); }
+};
+
+// The number of lanes of T in a register of the instruction set that the code is compiled for by default
+// (kernels compiled for several instruction sets should rather pick a fixed width)
+#if defined(__AVX512F__)
+template <typename T>
+constexpr std::size_t native_width = 64 / sizeof(T);
+#elif defined(__AVX__)
+template <typename T>
+constexpr std::size_t native_width = 32 / sizeof(T);
+#else
+template <typename T>
+constexpr std::size_t native_width = 16 / sizeof(T);
+#endif
+
+// mask ? a : b for each lane. Lanes as wide as the mask are blended bit by bit (a & mask | b & ~mask), which
+// compiles to a blend instead of a compare and a jump per lane.
+template <typename T, std::size_t N>
+constexpr pack<T, N> select(const pack_mask<N>& mask, const pack<T, N>& a, const pack<T, N>& b)
+{
+    auto result = pack<T, N>{};
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        if constexpr ((sizeof(T) == sizeof(std::uint32_t)) and std::is_trivially_copyable_v<T>)
+        {
+            const auto m = static_cast<std::uint32_t>(mask[i]);
+            const auto blended = (std::bit_cast<std::uint32_t>(a[i]) & m) | (std::bit_cast<std::uint32_t>(b[i]) & ~m);
+            result[i] = std::bit_cast<T>(blended);
+        }
+        else
+        {
+            result[i] = (mask[i] != 0) ? a[i] : b[i];
+        }
+    }
+    return result;
+}
+
+template <std::size_t N>
+constexpr bool any(const pack_mask<N>& mask)
+{
+    auto result = std::int32_t{0};
+    for (std::size_t i = 0; i < N; ++i)
+        result |= mask[i];
+    return result != 0;
+}
+
+template <std::size_t N>
+constexpr bool all(const pack_mask<N>& mask)
+{
+    auto result = std::int32_t{-1};
+    for (std::size_t i = 0; i < N; ++i)
+        result &= mask[i];
+    return result != 0;
+}
+
+template <std::size_t N>
+constexpr bool none(const pack_mask<N>& mask)
+{
+    return !any(mask);
+}
+
+// Convert each lane to another type
+template <typename To, typename From, std::size_t N>
+constexpr pack<To, N> pack_cast(const pack<From, N>& p)
+{
+    return map_lanes(p, [](const From x) { return static_cast<To>(x); });
+}
+
+// Load base[indices[i]] into lane i (and where there is a mask, only in the lanes where it is set, the
+// other lanes are taken from fallback and their indices are not used)
+template <typename T, std::size_t N>
+constexpr pack<T, N> gather(const T* base, const pack<int, N>& indices)
+{
+    return pack<T, N>::generate([&](const std::size_t i) { return base[indices[i]]; });
+}
+
+template <typename T, std::size_t N>
+constexpr pack<T, N> gather(const T* base, const pack<int, N>& indices, const pack_mask<N>& mask,
+                            const pack<T, N>& fallback)
+{
+    return pack<T, N>::generate([&](const std::size_t i) { return (mask[i] != 0) ? base[indices[i]] : fallback[i]; });
+}
+
+// The scalar policy of packs: Traits (the policy of a single lane, e.g. fast_math::traits whose functions
+// vectorize, unlike those of libm) applied to each lane
+template <typename T, std::size_t N, typename Traits = scalar_traits<T>>
+struct pack_traits
+{
+    using value_type = pack<T, N>;
+
+    static constexpr value_type infinity() { return Traits::infinity(); }
+    static constexpr value_type abs(const value_type& x) { return map_lanes(x, Traits::abs); }
+    static constexpr value_type floor(const value_type& x) { return map_lanes(x, Traits::floor); }
+    static constexpr value_type sin(const value_type& x) { return map_lanes(x, Traits::sin); }
+    static constexpr value_type cos(const value_type& x) { return map_lanes(x, Traits::cos); }
+    static constexpr value_type atan2(const value_type& y, const value_type& x)
+    {
+        return map_lanes(y, x, Traits::atan2);
+    }
+    static constexpr value_type reciprocal(const value_type& x) { return map_lanes(x, Traits::reciprocal); }
+};
+
+template <typename T, std::size_t N>
+struct scalar_traits<pack<T, N>> : pack_traits<T, N>
+{
+};
+
+template <typename T, std::size_t N>
+using vec2_pack = vec2<pack<T, N>>;
+
+template <typename T, std::size_t N>
+constexpr vec2_pack<int, N> to_vec2i(const vec2_pack<T, N>& v)
+{
+    return {.x = pack_cast<int>(v.x), .y = pack_cast<int>(v.y)};
+}
+
+// Lane i of a pack of vectors and a pack of vectors from a function of the lane
+template <typename T, std::size_t N>
+constexpr vec2<T> lane(const vec2_pack<T, N>& v, const std::size_t i)
+{
+    return {.x = v.x[i], .y = v.y[i]};
+}
+
+template <typename T, std::size_t N, typename F>
+constexpr vec2_pack<T, N> generate_vec2_pack(const F& f)
+{
+    auto result = vec2_pack<T, N>{};
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        const auto v = f(i);
+        result.x[i] = v.x;
+        result.y[i] = v.y;
+    }
+    return result;
+}
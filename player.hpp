@@ -0,0 +1,78 @@
+#pragma once
+
+#include <map.hpp>
+#include <math.hpp>
+#include <raycaster.hpp>
+
+// Represent a player by the position, the forward direction unit vector and a second unit
+// vector, perpendicular to the forward vector, pointing to the right of the player that
+// is used both for strafing and computing the (non-unit) ray direction vectors. Everything
+// is in the given scalar type (see scalar_traits), turning uses the trigonometry of Traits.
+template <typename T, typename Traits = scalar_traits<T>>
+class basic_player
+{
+public:
+    constexpr basic_player() = default;
+    constexpr explicit basic_player(const vec2<T>& pos)
+        : pos_(pos)
+    {
+    }
+
+    [[nodiscard]] constexpr vec2<T> pos() const { return pos_; }
+
+    // Imagine a screen one unit in front of the player, parallel to the right pointing
+    // vector, with coordinates starting at the very left of the screen at zero and
+    // ending at the very right of the screen at one. If you pass in a screen
+    // coordinate between zero and one, this function returns a vector that starts
+    // at the player position and ends at the corresponding point on the imagined
+    // screen. Note that only at 0.5 - i.e. the center of the screen - will this
+    // be a unit vector.
+    [[nodiscard]] constexpr vec2<T> line_of_sight(const T normalized_screen_x) const
+    {
+        return camera_ray((T{2} * normalized_screen_x) - T{1});
+    }
+
+    // The same as line_of_sight, but taking the offset along the imagined screen in [-1, 1] (where
+    // zero is the center of the screen) instead of the normalized screen coordinate
+    [[nodiscard]] constexpr vec2<T> camera_ray(const T offset) const { return forward_ + right_ * offset; }
+
+    // The camera that the player is looking through
+    [[nodiscard]] constexpr basic_camera<T> view() const { return {.pos = pos_, .forward = forward_, .right = right_}; }
+
+    // Movement is scaled by the elapsed time dt (in seconds) so that the distance travelled only
+    // depends on how long a key is held and not on how often the simulation or the renderer runs
+    constexpr void walk(const T factor, const T dt) { move(forward_ * (factor * run_speed * dt)); }
+    constexpr void strafe(const T factor, const T dt) { move(right_ * (factor * run_speed * dt)); }
+    constexpr void turn(const T factor, const T dt)
+    {
+        forward_ = rotate<T, Traits>(forward_, factor * turn_speed * dt);
+        right_ = rotate<T, Traits>(right_, factor * turn_speed * dt);
+    }
+
+    // The player state in between two simulation states p0 and p1 (t in [0, 1]). Used by the renderer
+    // to produce smooth motion when it runs at a different rate than the simulation.
+    friend constexpr basic_player lerp(const basic_player& p0, const basic_player& p1, const T t)
+    {
+        auto result = p1;
+        result.pos_ = lerp(p0.pos_, p1.pos_, t);
+        result.forward_ = lerp(p0.forward_, p1.forward_, t);
+        result.right_ = lerp(p0.right_, p1.right_, t);
+        return result;
+    }
+
+private:
+    constexpr void move(const vec2<T>& v)
+    {
+        const auto p = pos_ + v;
+        if (!is_wall(p)) pos_ = p;  // very primitive collision detection
+    }
+
+    vec2<T> pos_ = vec2<T>{.x = T{5}, .y = T{5}};
+    vec2<T> forward_ = vec2<T>{.x = T{0}, .y = T{1}};
+    vec2<T> right_ = vec2<T>{.x = T(0.8f), .y = T{0}};
+
+    constexpr static T run_speed = T{4};   // cells per second
+    constexpr static T turn_speed = T{2};  // radians per second
+};
+
+using player = basic_player<float>;
@@ -0,0 +1,616 @@
+#pragma once
+
+#include <fast_math.hpp>
+#include <frame_arena.hpp>
+#include <map.hpp>
+#include <math.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+//  The coordinates of each position/vector in the dda algorithm can be represented
+// by the grid coordinate (i.e. snapped to integer value) and the accompanying distance
+// along the ray that is being cast (in the scalar type of the ray, see scalar_traits).
+template <typename T = float>
+struct dda_coord
+{
+    int on_grid;
+    T distance;
+
+    // Two dda coordinates can be added simply by adding their value on the grid and
+    // adding the distances along the ray
+    constexpr dda_coord& operator+=(const dda_coord& other)
+    {
+        on_grid += other.on_grid;
+        distance += other.distance;
+        return *this;
+    }
+};
+
+// The face of a wall cell that a ray hit: the cell and whether the ray hit it while stepping in x
+// (i.e. the face is perpendicular to the x-axis). Rays coming from the same position that hit the
+// same cell while stepping in the same direction hit the very same face. If the ray gave up before
+// hitting anything (see ray_limits), is_hit is false and the cell is the last one it visited.
+struct wall_face
+{
+    vec2i cell;
+    bool is_x = false;
+    bool is_hit = true;
+
+    constexpr bool operator==(const wall_face&) const = default;
+};
+
+//  Whether all rays between two rays that hit the given faces are known to hit the same face (see
+// compute_span_wall_hits). That is never the case for rays that did not hit anything: the rays in
+// between might well have hit a wall before they gave up.
+constexpr bool is_coherent(const wall_face& first, const wall_face& last) { return first.is_hit and (first == last); }
+
+//  How the DDA takes its steps. Whether the next step is in x or in y is hard to predict for most rays (on a
+// diagonal ray it is a coin toss), so besides branching on it there are versions that always do the same work
+// and select what to add with bit masks (which compiles to conditional moves or blends instead of a jump) and
+// that additionally take two steps per iteration of the loop. All of them visit exactly the same cells.
+enum class dda_stepping : std::uint8_t
+{
+    branch,
+    select,
+    unrolled
+};
+
+constexpr std::string_view dda_stepping_name(const dda_stepping stepping)
+{
+    switch (stepping)
+    {
+    case dda_stepping::select: return "select";
+    case dda_stepping::unrolled: return "unrolled";
+    default: return "branch";
+    }
+}
+
+// The stepping with the given name (branch for anything unknown)
+constexpr dda_stepping parse_dda_stepping(const std::string_view name)
+{
+    if (name == "select") return dda_stepping::select;
+    if (name == "unrolled") return dda_stepping::unrolled;
+    return dda_stepping::branch;
+}
+
+//  How far a ray is traversed before it gives up: the far plane (a maximum distance in the same units as
+// wall_hit::distance) and a maximum number of grid steps. Without limits a ray only stops when it hits a
+// wall, so this is the only thing that keeps rays from running forever on open maps and it bounds the
+// time a ray can take on huge maps.
+struct ray_limits
+{
+    float max_distance = std::numeric_limits<float>::infinity();
+    int max_steps = std::numeric_limits<int>::max();
+
+    [[nodiscard]] constexpr bool is_bounded() const
+    {
+        return (max_distance != std::numeric_limits<float>::infinity()) or
+               (max_steps != std::numeric_limits<int>::max());
+    }
+};
+
+// How rays are cast: the stepping of the DDA and whether the step distances of float rays are computed with
+// fast_math::reciprocal (which is not exact, so rays then occasionally hit a different face than they should
+// close to a corner)
+struct ray_options
+{
+    dda_stepping stepping = dda_stepping::branch;
+    bool is_fast_math = false;
+};
+
+// Take a single step along the ray (in x if the distance along the ray in x is shorter, otherwise in y) and
+// return whether it was in x
+template <dda_stepping stepping, typename T>
+constexpr bool dda_step(dda_coord<T>& x, dda_coord<T>& y, const dda_coord<T>& x_step, const dda_coord<T>& y_step)
+{
+    const auto is_x_step = x.distance < y.distance;
+    if constexpr (stepping == dda_stepping::branch)
+    {
+        if (is_x_step)
+            x += x_step;
+        else
+            y += y_step;
+    }
+    else
+    {
+        // add the step (or zero, which leaves the coordinate exactly as it is) in both directions. GCC turns
+        // the equivalent conditional expressions back into a jump, which is why this is done with bit masks.
+        using bits = std::conditional_t<sizeof(T) == 8, std::uint64_t, std::uint32_t>;
+        const auto x_mask = -static_cast<bits>(is_x_step);
+        const auto y_mask = ~x_mask;
+        const auto masked = [](const T distance, const bits mask) {
+            return std::bit_cast<T>(std::bit_cast<bits>(distance) & mask);
+        };
+        x.on_grid += static_cast<int>(static_cast<std::uint32_t>(x_step.on_grid) & static_cast<std::uint32_t>(x_mask));
+        y.on_grid += static_cast<int>(static_cast<std::uint32_t>(y_step.on_grid) & static_cast<std::uint32_t>(y_mask));
+        x.distance += masked(x_step.distance, x_mask);
+        y.distance += masked(y_step.distance, y_mask);
+    }
+
+    return is_x_step;
+}
+
+//  To cast a ray we start with the initial x and y coordinates and the step in x and y
+// respectively. As long as the distance along the ray in the x-direction is shorter
+// than that travelled in the y direction, then we increment x by the x-step. Otherwise
+// we increment y by the y-step (see dda_step). When we hit a wall, we're finished. If the
+// ray is bounded and the next cell is beyond the far plane or we've run out of steps, we give up.
+template <bool is_bounded, dda_stepping stepping, typename Map, typename T>
+constexpr wall_face cast_ray(const Map& map, dda_coord<T> x, dda_coord<T> y, const dda_coord<T>& x_step,
+                             const dda_coord<T>& y_step, const ray_limits& limits)
+{
+    auto is_x_step = false;
+    auto steps = 0;
+    const auto max_distance = T{limits.max_distance};
+    const auto gives_up = [&] {
+        if constexpr (is_bounded)
+            return (steps++ >= limits.max_steps) or (std::min(x.distance, y.distance) > max_distance);
+        return false;
+    };
+    const auto missed = [&] { return wall_face{{x.on_grid, y.on_grid}, x.distance < y.distance, false}; };
+
+    while (!map.is_wall(vec2i{x.on_grid, y.on_grid}))
+    {
+        if (gives_up()) return missed();
+        is_x_step = dda_step<stepping>(x, y, x_step, y_step);
+
+        if constexpr (stepping == dda_stepping::unrolled)
+        {
+            if (map.is_wall(vec2i{x.on_grid, y.on_grid})) break;
+            if (gives_up()) return missed();
+            is_x_step = dda_step<stepping>(x, y, x_step, y_step);
+        }
+    }
+
+    // the result is the cell that was hit and whether the ray hit it while taking an x step
+    return {.cell = {x.on_grid, y.on_grid}, .is_x = is_x_step};
+}
+
+//  The DDA on a tiled map walks tile by tile: the bit mask of the current tile is only fetched when the ray
+// enters a new tile and every step within a tile only tests a bit of a register instead of computing the
+// address of the cell and loading it. Otherwise this is the same as the generic version above.
+template <bool is_bounded, dda_stepping stepping, typename T>
+constexpr wall_face cast_ray(const tiled_map& map, dda_coord<T> x, dda_coord<T> y, const dda_coord<T>& x_step,
+                             const dda_coord<T>& y_step, const ray_limits& limits)
+{
+    auto is_x_step = false;
+    auto steps = 0;
+    const auto max_distance = T{limits.max_distance};
+    const auto gives_up = [&] {
+        if constexpr (is_bounded)
+            return (steps++ >= limits.max_steps) or (std::min(x.distance, y.distance) > max_distance);
+        return false;
+    };
+    const auto missed = [&] { return wall_face{{x.on_grid, y.on_grid}, x.distance < y.distance, false}; };
+
+    auto tile_pos = tiled_map::tile_of({x.on_grid, y.on_grid});
+    auto tile = map.tile(tile_pos);
+    const auto is_wall = [&] {
+        if (const auto next_tile_pos = tiled_map::tile_of({x.on_grid, y.on_grid}); next_tile_pos != tile_pos)
+        {
+            tile_pos = next_tile_pos;
+            tile = map.tile(tile_pos);
+        }
+        return ((tile >> tiled_map::bit_of({x.on_grid, y.on_grid})) & 1) != 0;
+    };
+
+    while (!is_wall())
+    {
+        if (gives_up()) return missed();
+        is_x_step = dda_step<stepping>(x, y, x_step, y_step);
+
+        if constexpr (stepping == dda_stepping::unrolled)
+        {
+            if (is_wall()) break;
+            if (gives_up()) return missed();
+            is_x_step = dda_step<stepping>(x, y, x_step, y_step);
+        }
+    }
+
+    return {.cell = {x.on_grid, y.on_grid}, .is_x = is_x_step};
+}
+
+// Cast a ray with the given stepping, checking the limits on every step only if there are any (the checks
+// are not free: they make the inner loop about 1.5x slower)
+template <dda_stepping stepping, typename Map, typename T>
+constexpr wall_face cast_ray(const Map& map, const dda_coord<T>& x, const dda_coord<T>& y,
+                             const dda_coord<T>& x_step, const dda_coord<T>& y_step, const ray_limits& limits)
+{
+    return limits.is_bounded() ? cast_ray<true, stepping>(map, x, y, x_step, y_step, limits)
+                               : cast_ray<false, stepping>(map, x, y, x_step, y_step, limits);
+}
+
+// Cast a ray with the stepping selected by the options. Unbounded rays rely on the map being closed to terminate.
+template <typename Map, typename T>
+constexpr wall_face cast_ray(const Map& map, const dda_coord<T>& x, const dda_coord<T>& y,
+                             const dda_coord<T>& x_step, const dda_coord<T>& y_step, const ray_limits& limits = {},
+                             const ray_options& options = {})
+{
+    switch (options.stepping)
+    {
+    case dda_stepping::select: return cast_ray<dda_stepping::select>(map, x, y, x_step, y_step, limits);
+    case dda_stepping::unrolled: return cast_ray<dda_stepping::unrolled>(map, x, y, x_step, y_step, limits);
+    default: return cast_ray<dda_stepping::branch>(map, x, y, x_step, y_step, limits);
+    }
+}
+
+// Step on grid is -1 or 1 depending on ray direction
+template <typename T>
+constexpr int grid_step(const T dir)
+{
+    return (dir < T{0}) ? -1 : 1;
+}
+
+// Compute the start and step for a given x or y direction. Arguments are a coordinate (either
+// x or y) of the camera position and the corresponding component of the ray direction.
+template <typename T, typename Traits = scalar_traits<T>>
+constexpr auto initialize_dda_direction(const T pos, const T dir)
+{
+    const auto grid_pos = static_cast<int>(pos);
+
+    // Step distance along ray is the distance travelled along the ray if we cross a cell in this
+    // direction (resolves nicely to |1/dir|).
+    const auto step = dda_coord<T>{.on_grid = grid_step(dir), .distance = Traits::abs(Traits::reciprocal(dir))};
+
+    // Start on grid is the position of the camera snapped on to the grid. Start distance is the
+    // distance travelled along the ray in order to reach the edge of the current cell that corresponds
+    // to this direction (horizontal for x arguments, vertical for y arguments).
+    const auto aligned_edge_offset = (dir < T{0}) ? (pos - T(grid_pos)) : (T(grid_pos) + T{1} - pos);
+    const auto start = dda_coord<T>{.on_grid = grid_pos, .distance = step.distance * aligned_edge_offset};
+    return std::pair(start, step);
+}
+
+// Given a start position and a ray direction from that position find the wall face that the ray hits
+template <typename Map, typename T>
+constexpr wall_face find_wall_face(const Map& map, const vec2<T>& pos, const vec2<T>& dir,
+                                   const ray_limits& limits = {}, const ray_options& options = {})
+{
+    if constexpr (std::is_same_v<T, float>)
+    {
+        if (options.is_fast_math)
+        {
+            const auto [x_start, x_step] = initialize_dda_direction<T, fast_math::traits>(pos.x, dir.x);
+            const auto [y_start, y_step] = initialize_dda_direction<T, fast_math::traits>(pos.y, dir.y);
+            return cast_ray(map, x_start, y_start, x_step, y_step, limits, options);
+        }
+    }
+
+    const auto [x_start, x_step] = initialize_dda_direction(pos.x, dir.x);
+    const auto [y_start, y_step] = initialize_dda_direction(pos.y, dir.y);
+    return cast_ray(map, x_start, y_start, x_step, y_step, limits, options);
+}
+
+// A camera for casting rays: the position, the forward vector and the vector pointing to the right
+// along the camera plane (see player::line_of_sight). The ray direction for a screen column is
+// forward + right * offset where offset is the position of the column along the camera plane in [-1, 1].
+template <typename T = float>
+struct basic_camera
+{
+    vec2<T> pos;
+    vec2<T> forward;
+    vec2<T> right;
+
+    [[nodiscard]] constexpr vec2<T> ray(const T offset) const { return forward + right * offset; }
+};
+
+using camera = basic_camera<float>;
+
+// A wall hit is a distance from the camera to the wall and the texture coordinate in x (which
+// we use to determine whether the ray is hitting the left or right edge of a wall so that
+// we can visually delimit the walls when rendering)
+struct wall_hit
+{
+    float distance = 0.0f;
+    float tx = 0.0f;
+};
+
+// Given a start position, a ray direction from that position and the wall face that the ray hits,
+// compute the wall hit. This is just the intersection of the ray with the plane of the face. A ray
+// that did not hit anything is infinitely far away. The computation is done in the scalar type of the
+// ray and only the result is converted to float (the texture coordinate is a fraction, so it is as
+// precise as the scalar type is at the hit point).
+template <typename T>
+constexpr wall_hit intersect_wall_face(const vec2<T>& pos, const vec2<T>& dir, const wall_face& face)
+{
+    if (!face.is_hit) return {.distance = std::numeric_limits<float>::infinity()};
+
+    // Say we ended up hitting a wall while stepping in x, then we compute how far
+    // we had to cast the ray in the x-direction (which is the hit pos minus the
+    // start pos - but we have to correct for the snapped pos being in one
+    // corner of the cell: if we were travelling in the negative direction, then
+    // we hit the wall at the end of a step rather than at the beginning of the
+    // step so our hit pos is actually one too far. ((1 - step) >> 1) is just one
+    // if step is negative and other wise zero). Once we have the distance
+    // traversed in the given direction, then we just divide by the corresponding
+    // component of the direction vector to get the distance (see also how the
+    // start distance was calculated).
+    const auto distance = face.is_x ? (T(face.cell.x) - pos.x + T((1 - grid_step(dir.x)) >> 1)) / dir.x
+                                    : (T(face.cell.y) - pos.y + T((1 - grid_step(dir.y)) >> 1)) / dir.y;
+
+    // if we hit in the x direction then the tex coord is the fractional component
+    // of the y coordinate of the point where the ray hits the wall. And vice versa
+    // if we hit in the y direction.
+    const auto tx = face.is_x ? pos.y + distance * dir.y : pos.x + distance * dir.x;
+    return {static_cast<float>(distance), static_cast<float>(tx - scalar_traits<T>::floor(tx))};
+}
+
+// Given a start position and a ray direction from that position compute the wall hit
+template <typename Map, typename T>
+constexpr wall_hit compute_wall_hit(const Map& map, const vec2<T>& pos, const vec2<T>& dir,
+                                    const ray_limits& limits = {}, const ray_options& options = {})
+{
+    return intersect_wall_face(pos, dir, find_wall_face(map, pos, dir, limits, options));
+}
+
+// Whether there are walls in a pack of cells: a lookup per lane, or a gather for a grid_map
+template <typename Map, std::size_t N>
+constexpr pack_mask<N> is_wall(const Map& map, const vec2_pack<int, N>& cells)
+{
+    return pack_mask<N>::generate([&](const std::size_t i) { return lane_mask(map.is_wall(lane(cells, i))); });
+}
+
+template <std::size_t N>
+pack_mask<N> is_wall(const grid_map& map, const vec2_pack<int, N>& cells)
+{
+    return pack_cast<int>(gather(map.data(), cells.y * pack<int, N>{map.width()} + cells.x)) != pack<int, N>{0};
+}
+
+//  Find the wall faces that a pack of rays from the same position hit. The DDAs of all lanes run in lockstep:
+// every lane whose ray has not hit a wall yet takes a step and the lanes that have hit one stay where they
+// are until all rays have hit a wall. The steps are computed with exactly the same arithmetic as in
+// find_wall_face (a lane that does not step adds zero), so the faces are exactly the same. This only works
+// on closed maps (there are no ray limits). Each step of the pack costs as much as several scalar steps (the
+// map cells are still read one lane at a time), while the lanes wait for the longest ray of the pack.
+template <typename Map, std::size_t N>
+constexpr std::array<wall_face, N> find_wall_faces(const Map& map, const vec2f& pos, const vec2_pack<float, N>& dir)
+{
+    using floats = pack<float, N>;
+    using ints = pack<int, N>;
+
+    // the step on the grid, the step distance and the distance along the rays in x or y, see
+    // initialize_dda_direction
+    struct packed_dda
+    {
+        ints step;
+        floats step_distance;
+        floats distance;
+    };
+    const auto initialize = [](const float pos, const int grid_pos, const floats& dir) {
+        const auto is_negative = dir < floats{0.0f};
+        const auto step_distance = pack_traits<float, N>::abs(floats{1.0f} / dir);
+        const auto aligned_edge_offset = select(is_negative, floats{pos - static_cast<float>(grid_pos)},
+                                                floats{static_cast<float>(grid_pos) + 1.0f - pos});
+        return packed_dda{select(is_negative, ints{-1}, ints{1}), step_distance, step_distance * aligned_edge_offset};
+    };
+
+    auto cell = to_vec2i(vec2_pack<float, N>{.x = pos.x, .y = pos.y});
+    auto x = initialize(pos.x, cell.x[0], dir.x);
+    auto y = initialize(pos.y, cell.y[0], dir.y);
+    auto is_x = pack_mask<N>{0};
+    for (auto is_active = !is_wall(map, cell); any(is_active); is_active = is_active & !is_wall(map, cell))
+    {
+        const auto is_x_step = x.distance < y.distance;
+        const auto is_step_in_x = is_active & is_x_step;
+        const auto is_step_in_y = is_active & !is_x_step;
+        cell.x += select(is_step_in_x, x.step, ints{0});
+        cell.y += select(is_step_in_y, y.step, ints{0});
+        x.distance += select(is_step_in_x, x.step_distance, floats{0.0f});
+        y.distance += select(is_step_in_y, y.step_distance, floats{0.0f});
+        is_x = select(is_active, is_x_step, is_x);
+    }
+
+    auto faces = std::array<wall_face, N>{};
+    for (std::size_t i = 0; i < N; ++i)
+        faces[i] = {.cell = lane(cell, i), .is_x = is_x[i] != 0};
+    return faces;
+}
+
+// How many rays were actually cast (i.e. traversed the grid) to compute the wall hits for some columns
+struct ray_stats
+{
+    std::size_t columns = 0;
+    std::size_t rays_cast = 0;
+    std::size_t columns_approximated = 0;  // columns that were not computed exactly
+};
+
+//  Compute the wall hits of the columns strictly between first and last given the wall faces hit by
+// the rays of first and last. If both rays hit the same face, then all rays in between hit that face
+// too: the triangle between the camera and the two hit points cannot contain any wall (any wall cell
+// reaching into it would have stopped one of the two rays first). So the hits of the columns in between
+// are just ray-plane intersections with that face, which is exactly the computation that the full cast
+// ends with. Otherwise the range is split in the middle and both halves are handled recursively, unless
+// the range is no longer than column_step, in which case the columns in between are approximated by the
+// hit of the nearer end (so with a column_step of one the result is always exact).
+template <typename Map, typename T, typename RayDirection>
+constexpr void compute_span_wall_hits(const Map& map, const std::span<wall_hit> hits, const vec2<T>& pos,
+                                      const RayDirection& ray_dir, const std::size_t first,
+                                      const wall_face& first_face, const std::size_t last,
+                                      const wall_face& last_face, const std::size_t column_step,
+                                      const ray_limits& limits, const ray_options& options, ray_stats& stats)
+{
+    if (last - first < 2) return;
+
+    if (is_coherent(first_face, last_face))
+    {
+        for (auto i = first + 1; i < last; ++i)
+            hits[i] = intersect_wall_face(pos, ray_dir(i), first_face);
+        return;
+    }
+
+    if (last - first <= column_step)
+    {
+        for (auto i = first + 1; i < last; ++i)
+            hits[i] = hits[(i - first <= last - i) ? first : last];
+        stats.columns_approximated += last - first - 1;
+        return;
+    }
+
+    const auto middle = first + (last - first) / 2;
+    const auto middle_dir = ray_dir(middle);
+    const auto middle_face = find_wall_face(map, pos, middle_dir, limits, options);
+    hits[middle] = intersect_wall_face(pos, middle_dir, middle_face);
+    ++stats.rays_cast;
+
+    compute_span_wall_hits(map, hits, pos, ray_dir, first, first_face, middle, middle_face, column_step, limits,
+                           options, stats);
+    compute_span_wall_hits(map, hits, pos, ray_dir, middle, middle_face, last, last_face, column_step, limits,
+                           options, stats);
+}
+
+//  Compute the wall hits on the map for all columns where ray_dir(i) is the ray direction of column i.
+// Rays are only cast at span boundaries (every span_width columns) and the columns in between are filled
+// in by compute_span_wall_hits. With a column step of one the result is identical to casting a ray per
+// column (and a span width of one casts a ray for every column). A larger column step trades accuracy
+// for fewer rays: spans are at least column_step wide and are not subdivided below that.
+template <typename Map, typename T, typename RayDirection>
+constexpr ray_stats compute_wall_hits(const Map& map, const std::span<wall_hit> hits, const vec2<T>& pos,
+                                      const RayDirection& ray_dir, const std::size_t span_width,
+                                      const std::size_t column_step = 1, const ray_limits& limits = {},
+                                      const ray_options& options = {})
+{
+    auto stats = ray_stats{.columns = hits.size()};
+    if (hits.empty()) return stats;
+
+    const auto cast = [&](const std::size_t i) {
+        const auto dir = ray_dir(i);
+        const auto face = find_wall_face(map, pos, dir, limits, options);
+        hits[i] = intersect_wall_face(pos, dir, face);
+        ++stats.rays_cast;
+        return face;
+    };
+
+    const auto span = std::max({span_width, column_step, std::size_t{1}});
+    auto first = std::size_t{0};
+    auto first_face = cast(first);
+    while (first + 1 < hits.size())
+    {
+        const auto last = std::min(first + span, hits.size() - 1);
+        const auto last_face = cast(last);
+        compute_span_wall_hits(map, hits, pos, ray_dir, first, first_face, last, last_face, column_step, limits,
+                               options, stats);
+        first = last;
+        first_face = last_face;
+    }
+
+    return stats;
+}
+
+//  Compute the wall hits on the map for all columns by casting the rays of N neighbouring columns at once (see
+// find_wall_faces). The last pack is padded with the ray of the last column. The result is exactly the same
+// as casting a ray for every column, but it is only about as fast in the maze and several times slower in
+// maps with long rays (see benchmark_packed_rays), so the renderer does not use it.
+template <std::size_t N, typename Map, typename RayDirection>
+constexpr ray_stats compute_wall_hits_packed(const Map& map, const std::span<wall_hit> hits, const vec2f& pos,
+                                             const RayDirection& ray_dir)
+{
+    const auto n = hits.size();
+    for (std::size_t first = 0; first < n; first += N)
+    {
+        const auto dir = generate_vec2_pack<float, N>([&](const std::size_t i) {
+            return ray_dir(std::min(first + i, n - 1));
+        });
+        const auto faces = find_wall_faces(map, pos, dir);
+        for (std::size_t i = 0; (i < N) and (first + i < n); ++i)
+            hits[first + i] = intersect_wall_face(pos, lane(dir, i), faces[i]);
+    }
+
+    return {.columns = n, .rays_cast = n};
+}
+
+//  Compute the wall hits in coarse to fine order until is_over_budget() returns true: first column zero,
+// then the column in the middle, then the columns at a quarter and three quarters and so on (i.e. the
+// columns at odd multiples of decreasing powers of two). Once the columns on the previous level are at most
+// span_width apart, wherever the rays of the two columns enclosing a column hit the same wall face, its hit
+// is computed without casting a ray (see compute_span_wall_hits). When the budget runs out, the remaining
+// columns take the hit of the nearest computed column, so stopping at any point still gives an approximation
+// of the whole screen which gets finer the more time there is. The budget is checked every few columns
+// because reading the clock is not free.
+template <typename Map, typename T, typename RayDirection, typename Budget>
+ray_stats compute_wall_hits_progressive(const Map& map, const std::span<wall_hit> hits, const vec2<T>& pos,
+                                        const RayDirection& ray_dir, const std::size_t span_width,
+                                        const ray_limits& limits, const ray_options& options,
+                                        const Budget& is_over_budget, frame_arena& arena)
+{
+    constexpr auto budget_check_interval = std::size_t{16};
+
+    const auto n = hits.size();
+    auto stats = ray_stats{.columns = n};
+    if (n == 0) return stats;
+
+    const auto faces = arena.allocate<wall_face>(n);
+    const auto is_computed = arena.allocate<std::uint8_t>(n);
+    std::ranges::fill(is_computed, std::uint8_t{0});
+
+    const auto cast = [&](const std::size_t i) {
+        const auto dir = ray_dir(i);
+        faces[i] = find_wall_face(map, pos, dir, limits, options);
+        hits[i] = intersect_wall_face(pos, dir, faces[i]);
+        is_computed[i] = 1;
+        ++stats.rays_cast;
+    };
+
+    cast(0);
+    auto num_computed = std::size_t{1};
+    auto is_out_of_time = false;
+    for (auto stride = std::bit_ceil(n) / 2; (stride > 0) and !is_out_of_time; stride /= 2)
+    {
+        for (auto i = stride; i < n; i += 2 * stride)
+        {
+            if ((num_computed++ % budget_check_interval == 0) and is_over_budget())
+            {
+                is_out_of_time = true;
+                break;
+            }
+
+            // the neighbours at i - stride and i + stride are on coarser levels and have been computed already
+            const auto is_span_coherent =
+                (2 * stride <= span_width) and (i + stride < n) and is_coherent(faces[i - stride], faces[i + stride]);
+            if (is_span_coherent)
+            {
+                faces[i] = faces[i - stride];
+                hits[i] = intersect_wall_face(pos, ray_dir(i), faces[i]);
+                is_computed[i] = 1;
+            }
+            else
+            {
+                cast(i);
+            }
+        }
+    }
+
+    if (!is_out_of_time) return stats;
+
+    // fill the gaps from the nearest computed column: first find the nearest computed column to the left
+    // (column zero is always computed) and then replace it with the one to the right if that is closer
+    const auto nearest_left = arena.allocate<std::uint32_t>(n);
+    for (std::size_t i = 0, left = 0; i < n; ++i)
+    {
+        if (is_computed[i]) left = i;
+        nearest_left[i] = static_cast<std::uint32_t>(left);
+    }
+
+    for (auto i = n, right = n; i-- > 0;)
+    {
+        if (is_computed[i])
+        {
+            right = i;
+            continue;
+        }
+
+        const auto left = std::size_t{nearest_left[i]};
+        hits[i] = hits[((right < n) and (right - i < i - left)) ? right : left];
+        ++stats.columns_approximated;
+    }
+
+    return stats;
+}
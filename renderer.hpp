@@ -0,0 +1,869 @@
+#pragma once
+
+#include <bsp.hpp>
+#include <frame_arena.hpp>
+#include <framebuffer.hpp>
+#include <kernels.hpp>
+#include <map.hpp>
+#include <player.hpp>
+#include <raycaster.hpp>
+#include <sprites.hpp>
+#include <texture.hpp>
+#include <wall_hit_table.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// For a given fraction (i.e. x in [0, 1]) return the character that best represents that
+// fraction of a whole block (used to generate the smoothing effect on the top and bottom
+// of walls)
+constexpr char32_t fractional_block(const float x)
+{
+    constexpr auto chars =
+        std::array{U' ', U'\u2581', U'\u2582', U'\u2583', U'\u2584', U'\u2585', U'\u2586', U'\u2587'};
+    const auto index = static_cast<int>(x * (chars.size() - 1e-6f));
+    return chars[index];
+}
+
+// The shade characters that walls fade through as they disappear into the fog (the last one is the fog)
+constexpr char32_t fog_glyph(const float fog)
+{
+    constexpr auto chars = std::array{U'\u2593', U'\u2592', U'\u2591'};
+    return chars[std::min(chars.size() - 1, static_cast<std::size_t>(fog * chars.size()))];
+}
+
+//  The distance at which everything has disappeared into the fog: the far plane, or for rays that are only limited
+// in steps the distance that every ray reaches before it runs out of steps, so that rays that missed are drawn as
+// a wall of fog at a finite distance. A ray crosses one cell boundary per step, at most two per unit of distance
+// within the field of view of the player (see player::camera_ray) and up to two to leave the cell it starts in.
+constexpr float fog_distance(const ray_limits& limits)
+{
+    if (!std::isinf(limits.max_distance) or (limits.max_steps == std::numeric_limits<int>::max()))
+        return limits.max_distance;
+
+    return std::max(0.5f * static_cast<float>(limits.max_steps - 2), 1.0f);
+}
+
+// How much of a wall at the given distance is hidden by fog (in [0, 1]): none up to fog_start (a fraction
+// of the fog distance), then more and more up to the fog distance and all of it beyond
+constexpr float fog_amount(const float distance, const ray_limits& limits, const float fog_start)
+{
+    const auto end = fog_distance(limits);
+    if (std::isinf(distance) or (distance > end)) return 1.0f;
+
+    const auto start = fog_start * end;
+    return (distance <= start) ? 0.0f : (distance - start) / (end - start);
+}
+
+//  Shading by distance (see shaded_mode). Distances are quantized to a few shades (see num_shades) so that walls
+// and floors at similar distances share a color and the encoder can send them in long runs with few color
+// changes. shade_limits are the distances up to which each shade is used (the last one is used for everything
+// beyond) and shade_table is the lookup table of the shade for distances in steps of 1/shade_table_resolution.
+constexpr auto shade_limits = std::array<float, num_shades - 1>{1.5f, 2.5f, 4.0f, 6.0f, 9.0f};
+constexpr auto shade_table_resolution = 16.0f;
+constexpr auto shade_table = [] {
+    auto table = std::array<std::uint8_t, 256>{};
+    for (std::size_t i = 0; i < table.size(); ++i)
+    {
+        const auto distance = static_cast<float>(i) / shade_table_resolution;
+        table[i] = static_cast<std::uint8_t>(1 + std::ranges::count_if(shade_limits, [&](const float limit) {
+                                                 return limit <= distance;
+                                             }));
+    }
+    return table;
+}();
+
+// The shade (a color, see cell) of something at the given distance
+constexpr std::uint8_t shade_of(const float distance)
+{
+    const auto index = distance * shade_table_resolution;
+    return (index < static_cast<float>(shade_table.size())) ? shade_table[static_cast<std::size_t>(index)]
+                                                            : static_cast<std::uint8_t>(num_shades);
+}
+
+// The first row of a screen with the given height where the floor is no farther away than distance (the floor
+// seen in row y is at distance height / (2y + 1 - height), the distance of a wall whose bottom edge is there)
+inline int first_floor_row(const int height, const float distance)
+{
+    const auto h = static_cast<float>(height);
+    return static_cast<int>(std::ceil((h / distance + h - 1.0f) / 2.0f));
+}
+
+//  Rendering modes are policy types that draw_column and draw_scene are instantiated for, so that the mode is
+// picked once per frame (see visit_render_mode) and the loops that draw the columns don't branch on it. A mode
+// says whether the top and bottom edges of walls are smoothed with fractional blocks, which character the
+// wall is drawn with and with which attributes, whether walls and floors are shaded by distance and whether
+// walls are textured instead.
+
+// Walls as whole blocks
+struct blocky_mode
+{
+    static constexpr int rays_per_cell = 1;
+    static constexpr bool is_smoothed = false;
+    static constexpr bool is_shaded = false;
+    static constexpr bool is_textured = false;
+    static constexpr std::uint8_t wall_attributes = attribute::reversed;
+
+    // anything on the left or right edge of a wall cell is rendered using a different character
+    // (wall chars are rendered with the invert flag set to true so " " is actually a solid block)
+    static constexpr char32_t wall_glyph(const wall_hit& hit, float /*fog*/)
+    {
+        return ((hit.tx < 0.1f) or (hit.tx > 0.9)) ? U'\u2502' : U' ';
+    }
+};
+
+// Walls with their top and bottom edges smoothed with fractional blocks
+struct smooth_mode : blocky_mode
+{
+    static constexpr bool is_smoothed = true;
+};
+
+// Smooth walls and the floor in shades of grey that get darker with distance (see shade_of)
+struct shaded_mode : smooth_mode
+{
+    static constexpr bool is_shaded = true;
+};
+
+// Walls drawn from a texture (see wall_texture and draw_textured_column) in whole cells
+struct textured_mode : blocky_mode
+{
+    static constexpr bool is_textured = true;
+};
+
+// Walls in the fog (see fog_amount), drawn with shade characters instead of solid blocks and without smoothed
+// edges in any mode
+struct fog_mode
+{
+    static constexpr bool is_smoothed = false;
+    static constexpr bool is_shaded = false;
+    static constexpr std::uint8_t wall_attributes = attribute::none;
+
+    static constexpr char32_t wall_glyph(const wall_hit& /*hit*/, const float fog) { return fog_glyph(fog); }
+};
+
+//  Walls drawn with braille characters (U+2800 to U+28FF), which have a grid of 2x4 dots per cell. Two rays are
+// cast per cell column (one per column of dots), so walls have twice the horizontal and four times the vertical
+// resolution of the other modes (see draw_braille_column).
+struct braille_mode
+{
+    static constexpr int rays_per_cell = 2;
+};
+
+// The rendering modes that can be selected (fog_mode is only used for the columns in the fog)
+enum class render_mode
+{
+    smooth,
+    blocky,
+    braille,
+    shaded,
+    textured
+};
+
+constexpr std::string_view render_mode_name(const render_mode mode)
+{
+    switch (mode)
+    {
+    case render_mode::blocky: return "blocky";
+    case render_mode::braille: return "braille";
+    case render_mode::shaded: return "shaded";
+    case render_mode::textured: return "textured";
+    default: return "smooth";
+    }
+}
+
+// The rendering mode with the given name (smooth for anything unknown)
+constexpr render_mode parse_render_mode(const std::string_view name)
+{
+    if (name == "blocky") return render_mode::blocky;
+    if (name == "braille") return render_mode::braille;
+    if (name == "shaded") return render_mode::shaded;
+    if (name == "textured") return render_mode::textured;
+    return render_mode::smooth;
+}
+
+// The next rendering mode in the order they are cycled through in the game
+constexpr render_mode next(const render_mode mode)
+{
+    switch (mode)
+    {
+    case render_mode::smooth: return render_mode::blocky;
+    case render_mode::blocky: return render_mode::braille;
+    case render_mode::braille: return render_mode::shaded;
+    case render_mode::shaded: return render_mode::textured;
+    default: return render_mode::smooth;
+    }
+}
+
+// Call f with the policy type of the given rendering mode (a default constructed instance of it)
+template <typename F>
+constexpr decltype(auto) visit_render_mode(const render_mode mode, F&& f)
+{
+    switch (mode)
+    {
+    case render_mode::blocky: return f(blocky_mode{});
+    case render_mode::braille: return f(braille_mode{});
+    case render_mode::shaded: return f(shaded_mode{});
+    case render_mode::textured: return f(textured_mode{});
+    default: return f(smooth_mode{});
+    }
+}
+
+// given the screen height and the corresponding wall hit, draw a column of characters representing
+// the ceiling, wall and floor that are visible in that column in the given mode. The fog is only used by
+// the fog mode.
+template <typename Mode>
+void draw_column(framebuffer& frame, const int x, const wall_hit hit, const float fog = 0.0f)
+{
+    constexpr auto is_smoothed = Mode::is_smoothed;
+    if ((x < 0) or (x >= frame.width())) return;
+
+    const auto screen_height = frame.height();
+
+    // The floating point height of the wall projected into screen space
+    const auto exact_wall_height = static_cast<float>(screen_height) / hit.distance;
+
+    // The number of whole characters that would be needed to represent the wall. If we're
+    // smoothing the edges then the number of whole chars is always even because an odd
+    // truncated wall height is achieved using an even number of whole blocks with a half
+    // block on the top and the bottom (that way the walls are always centered correctly)
+    const auto truncated_wall_height = static_cast<int>(exact_wall_height);
+    const auto num_whole_chars = truncated_wall_height - (is_smoothed ? (truncated_wall_height % 2) : 0);
+
+    // The y-coordinate (or row position within the column) of the top and bottom of the wall.
+    // This is where the fractional blocks will go if we're smoothing the edges
+    const auto wall_top = ((screen_height - num_whole_chars) / 2) - 1;
+    const auto wall_bottom = wall_top + num_whole_chars + 2;
+
+    // Where the sequence of wall and floor chars start (add one if we're smoothing the edges
+    // to make space for the fractional blocks)
+    const auto wall_start = wall_top + (is_smoothed ? 1 : 0);
+    const auto floor_start = wall_bottom + (is_smoothed ? 1 : 0);
+
+    // fill the rows between min and max (clamped to the screen, nothing if max < min) with a character
+    const auto fill = [&](int min, int max, const char32_t c, const std::uint8_t attributes = attribute::none,
+                          const std::uint8_t color = 0) {
+        min = std::max(0, min);
+        max = std::min(screen_height, max);
+        frame.fill_column(x, std::min(min, max), max, {c, attributes, color});
+    };
+
+    // render the ceiling, wall and floor characters respectively. A shaded floor is drawn in bands of rows with
+    // the same shade from the bottom (the nearest) up.
+    const auto wall_color = Mode::is_shaded ? shade_of(hit.distance) : std::uint8_t{0};
+    fill(0, wall_top, U' ');
+    fill(wall_start, wall_bottom, Mode::wall_glyph(hit, fog), Mode::wall_attributes, wall_color);
+    if constexpr (Mode::is_shaded)
+    {
+        auto band_end = screen_height;
+        for (std::size_t i = 0; i < shade_limits.size(); ++i)
+        {
+            const auto band_start = std::max(floor_start, first_floor_row(screen_height, shade_limits[i]));
+            fill(band_start, band_end, U'.', attribute::none, static_cast<std::uint8_t>(i + 1));
+            band_end = std::min(band_end, band_start);
+        }
+        fill(floor_start, band_end, U'.', attribute::none, num_shades);
+    }
+    else
+    {
+        fill(floor_start, screen_height, U'.');
+    }
+
+    // if we're smoothing the edges and the edges are on the screen, then print the fractional blocks
+    if constexpr (is_smoothed)
+    {
+        if (wall_top >= 0)
+        {
+            // split the left over bit of the wall height after rendering the whole blocks over
+            // the top and bottom fractional blocks
+            const auto fraction = 0.5f * (exact_wall_height - static_cast<float>(num_whole_chars));
+            frame.put(x, wall_top, fractional_block(fraction), attribute::none, wall_color);
+            frame.put(x, wall_bottom, fractional_block(1.0f - fraction), attribute::reversed, wall_color);
+        }
+    }
+}
+
+namespace braille
+{
+    // The dots of a column of a braille cell (bit i is the dot in row i from the top) as the bits of the character
+    // for the left and the right column
+    constexpr auto column_bits = [] {
+        constexpr auto dots =
+            std::array<std::array<std::uint8_t, 4>, 2>{{{0x01, 0x02, 0x04, 0x40}, {0x08, 0x10, 0x20, 0x80}}};
+        auto bits = std::array<std::array<std::uint8_t, 16>, 2>{};
+        for (std::size_t side = 0; side < 2; ++side)
+            for (std::size_t mask = 0; mask < 16; ++mask)
+                for (std::size_t row = 0; row < 4; ++row)
+                    if (((mask >> row) & 1) != 0) bits[side][mask] |= dots[side][row];
+
+        return bits;
+    }();
+
+    // The dots of a column of the cell that starts at dot row top that are in the dot rows [begin, end)
+    constexpr unsigned rows_between(const int begin, const int end, const int top)
+    {
+        const auto first = std::clamp(begin - top, 0, 4);
+        const auto last = std::clamp(end - top, 0, 4);
+        return ((1u << last) - 1u) & ~((1u << first) - 1u);
+    }
+
+    // A column of dots: the dot rows of the wall, which of its dots are lit (repeated for every cell) and where
+    // the floor starts
+    struct dot_column
+    {
+        int wall_begin;
+        int wall_end;
+        unsigned wall_dots;
+    };
+
+    //  The column of dots for a wall hit on a screen with the given number of dot rows. Walls are lit except on
+    // the edges of a wall cell (which leaves a dark line between cells) and walls in the fog (see fog_amount) are
+    // thinned out to a checkerboard and then to a sparse pattern, the same steps that fog_glyph goes through.
+    constexpr dot_column column_of(const wall_hit& hit, const int dot_rows, const float fog, const int side)
+    {
+        const auto height = static_cast<int>(static_cast<float>(dot_rows) / hit.distance);
+        const auto wall_begin = (dot_rows - std::min(height, dot_rows)) / 2;
+
+        constexpr auto fog_dots = std::array<std::array<unsigned, 2>, 3>{{{0xf, 0xf}, {0x5, 0xa}, {0x1, 0x4}}};
+        const auto is_edge = (hit.tx < 0.1f) or (hit.tx > 0.9);
+        const auto level = std::min<std::size_t>(2, static_cast<std::size_t>(fog * 3.0f));
+        const auto wall_dots = (fog > 0.0f) ? fog_dots[level][side] : (is_edge ? 0u : 0xfu);
+        return {wall_begin, wall_begin + std::min(height, dot_rows), wall_dots};
+    }
+}
+
+//  Draw cell column x in braille from the wall hits of its left and right column of dots (and the fog of each).
+// The dots of a cell are packed into the bits of the character from the masks of the rows that the wall and the
+// floor (a dot in the bottom left corner of every cell, like the '.' of the other modes) cover. Only the (at most
+// four) cells that an end of a wall falls into are mixed, the runs of cells between them are all the same and
+// are filled without packing each cell.
+inline void draw_braille_column(framebuffer& frame, const int x, const std::array<wall_hit, 2>& hits,
+                                const std::array<float, 2>& fog)
+{
+    if ((x < 0) or (x >= frame.width())) return;
+
+    const auto height = frame.height();
+    const auto dot_rows = 4 * height;
+    const auto left = braille::column_of(hits[0], dot_rows, fog[0], 0);
+    const auto right = braille::column_of(hits[1], dot_rows, fog[1], 1);
+    constexpr auto floor_dots = 0x8u;
+
+    const auto cell_at = [&](const int y) {
+        const auto top = 4 * y;
+        const auto left_dots = (braille::rows_between(left.wall_begin, left.wall_end, top) & left.wall_dots) |
+                               (braille::rows_between(left.wall_end, dot_rows, top) & floor_dots);
+        const auto right_dots = braille::rows_between(right.wall_begin, right.wall_end, top) & right.wall_dots;
+        const auto bits = braille::column_bits[0][left_dots] | braille::column_bits[1][right_dots];
+        return cell{(bits == 0) ? U' ' : static_cast<char32_t>(0x2800 + bits)};
+    };
+
+    auto mixed = std::array{left.wall_begin / 4, left.wall_end / 4, right.wall_begin / 4, right.wall_end / 4};
+    std::ranges::sort(mixed);
+
+    auto y = 0;
+    for (const auto m : mixed)
+    {
+        const auto end = std::min(m, height);
+        if (y < end) frame.fill_column(x, y, end, cell_at(y));
+        if (end < height) frame.row(end)[static_cast<std::size_t>(x)] = cell_at(end);
+        y = std::max(y, end + 1);
+    }
+    if (y < height) frame.fill_column(x, y, height, cell_at(y));
+}
+
+//  Draw column x with a textured wall (see textured_mode). The ceiling and the floor are the same as in the other
+// modes and the wall covers the cells whose centers are within its exact height. Its cells are the texels of one
+// stripe of the texture (from the mip level for the height of the wall) that is stepped through incrementally: the
+// texture row is a 16.16 fixed point number that advances by the texture rows per cell, so there is one division
+// per column instead of one per cell.
+inline void draw_textured_column(framebuffer& frame, const int x, const wall_hit hit, const wall_texture& texture)
+{
+    if ((x < 0) or (x >= frame.width())) return;
+
+    const auto screen_height = frame.height();
+    const auto exact_wall_height = static_cast<float>(screen_height) / hit.distance;
+    const auto exact_wall_top = 0.5f * (static_cast<float>(screen_height) - exact_wall_height);
+    const auto wall_begin = std::clamp(static_cast<int>(std::ceil(exact_wall_top - 0.5f)), 0, screen_height);
+    const auto wall_end =
+        std::clamp(static_cast<int>(std::ceil(exact_wall_top + exact_wall_height - 0.5f)), wall_begin, screen_height);
+
+    frame.fill_column(x, 0, wall_begin, {U' '});
+    frame.fill_column(x, wall_end, screen_height, {U'.'});
+    if (wall_begin == wall_end) return;
+
+    constexpr auto one = static_cast<float>(1 << 16);
+    const auto stripe = texture.stripe(texture.level_for(exact_wall_height), hit.tx);
+    const auto step = static_cast<float>(stripe.size()) / exact_wall_height;
+    const auto first_row = (static_cast<float>(wall_begin) + 0.5f - exact_wall_top) * step;
+    const auto last = static_cast<std::uint32_t>(stripe.size() - 1);
+    auto row = static_cast<std::uint32_t>(std::max(0.0f, first_row) * one);
+    const auto row_step = static_cast<std::uint32_t>(step * one);
+    frame.generate_column(x, wall_begin, wall_end, [&] {
+        const auto texel = stripe[std::min(row >> 16, last)];
+        row += row_step;
+        return texel;
+    });
+}
+
+//  Floor and ceiling casting (see render_settings::is_floor_cast): the floor and the ceiling are drawn in
+// perspective from their textures (see builtin_floor_texture, a texture per cell of the map) instead of as plain
+// rows. Every row below the horizon shows the floor at one distance (see first_floor_row) and every row above it
+// the ceiling at the distance of the row mirrored at the horizon, so the points that a row shows are evenly spaced
+// between the points of the leftmost and the rightmost ray at that distance. The texels of a row are found by
+// interpolating between the two for the whole row at once (a loop of arithmetic only, which the compiler
+// vectorizes) and then copied into the cells that the walls left empty (the floor and ceiling cells of
+// draw_column). The sizes of the textures must be powers of two. The textures are shaded by the distance of the
+// row in the shaded modes and rows beyond max_distance (the fog distance) are left as they are.
+template <typename Mode>
+void cast_floor_and_ceiling(framebuffer& frame, const camera& cam, const float max_distance, frame_arena& arena)
+{
+    const auto columns = frame.width();
+    const auto width = static_cast<std::size_t>(columns);
+    const auto height = frame.height();
+    const auto last = static_cast<float>(std::max(1, columns - 1));
+    const auto step = 1.0f / last;
+    const auto left = cam.ray(-1.0f);
+    const auto across = cam.ray(1.0f) - left;
+    const auto indices = arena.allocate<std::int32_t>(width);
+
+    // cast row y at the given distance from a texture into the cells that are empty (the glyph without attributes)
+    const auto cast_row = [&](const int y, const float distance, const wall_texture& texture, const char32_t empty) {
+        // the mip level for the number of cells that a cell of the map spans in this row
+        const auto level = texture.level_for(last / (distance * std::hypot(across.x, across.y)));
+        const auto [texture_width, texture_height] = texture.level_size(level);
+        const auto texels = texture.texels(level);
+        const auto start = cam.pos + left * distance;
+        const auto span = across * distance;
+        const auto u_scale = static_cast<float>(texture_width);
+        const auto v_scale = static_cast<float>(texture_height);
+        const auto v_bits = std::countr_zero(static_cast<unsigned>(texture_height));
+        for (int x = 0; x < columns; ++x)
+        {
+            // the texture repeats in every cell of the map, so the texel coordinates wrap around (which is a mask
+            // for sizes that are powers of two, and for points outside of the map it doesn't matter where they
+            // wrap to as long as they stay in range)
+            const auto t = static_cast<float>(x) * step;
+            const auto u = static_cast<int>((start.x + span.x * t) * u_scale) & (texture_width - 1);
+            const auto v = static_cast<int>((start.y + span.y * t) * v_scale) & (texture_height - 1);
+            indices[static_cast<std::size_t>(x)] = (u << v_bits) | v;
+        }
+
+        const auto row = frame.row(y);
+        const auto color = Mode::is_shaded ? shade_of(distance) : std::uint8_t{0};
+        for (std::size_t x = 0; x < width; ++x)
+        {
+            if ((row[x].glyph != empty) or (row[x].attributes != attribute::none)) continue;
+
+            row[x] = texels[static_cast<std::size_t>(indices[x])];
+            if constexpr (Mode::is_shaded) row[x].color = color;
+        }
+    };
+
+    for (int y = 0; y < height; ++y)
+    {
+        // rows below the horizon show the floor, rows above it the ceiling (and a middle row neither)
+        const auto below = 2 * y + 1 - height;
+        if (below == 0) continue;
+
+        const auto distance = static_cast<float>(height) / static_cast<float>(std::abs(below));
+        if (distance > max_distance) continue;
+
+        if (below > 0)
+            cast_row(y, distance, builtin_floor_texture(), U'.');
+        else
+            cast_row(y, distance, builtin_ceiling_texture(), U' ');
+    }
+}
+
+//  The post-processing pass (see render_settings::is_dithered): walls drawn as solid blocks are shaded by
+// distance with density glyphs (the full block and the shade characters). The distance of each column is scaled
+// to a density level and the threshold of a 4x4 Bayer matrix is added before it is truncated, so that the levels
+// blend into each other in an ordered dither instead of bands. It works on the whole framebuffer a row at a time
+// and every cell goes through the same selects (no branches), so the compiler vectorizes it.
+constexpr auto dither_distance = 10.0f;  // where walls reach the lightest density
+
+constexpr auto bayer_thresholds = [] {
+    constexpr auto bayer =
+        std::array<std::array<int, 4>, 4>{{{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}}};
+    auto thresholds = std::array<std::array<float, 4>, 4>{};
+    for (std::size_t y = 0; y < 4; ++y)
+        for (std::size_t x = 0; x < 4; ++x)
+            thresholds[y][x] = (static_cast<float>(bayer[y][x]) + 0.5f) / 16.0f;
+
+    return thresholds;
+}();
+
+// Dither the solid walls of the frame by the distances of the wall hits (one per column)
+inline void dither_walls(framebuffer& frame, const std::span<const wall_hit> hits, frame_arena& arena)
+{
+    // the dithered density level of every column in each of the four rows of the Bayer matrix, before it is
+    // truncated (0 is the full block, 3 the lightest shade)
+    const auto width = std::min(static_cast<std::size_t>(frame.width()), hits.size());
+    const auto levels = arena.allocate<float>(4 * width);
+    for (std::size_t i = 0; i < 4; ++i)
+        for (std::size_t x = 0; x < width; ++x)
+            levels[i * width + x] = hits[x].distance * (3.0f / dither_distance) + bayer_thresholds[i][x & 3];
+
+    for (int y = 0; y < frame.height(); ++y)
+    {
+        const auto row = frame.row(y);
+        const auto row_levels = levels.subspan(static_cast<std::size_t>(y & 3) * width, width);
+        for (std::size_t x = 0; x < width; ++x)
+        {
+            // the full block and then the dark, medium and light shade (U+2593 down to U+2591)
+            const auto level = static_cast<int>(std::min(row_levels[x], 3.0f));
+            const auto density = (level == 0) ? U'\u2588' : static_cast<char32_t>(U'\u2594' - level);
+            const auto is_solid = (row[x].glyph == U' ') & (row[x].attributes == attribute::reversed);
+            row[x].glyph = is_solid ? density : row[x].glyph;
+            row[x].attributes = is_solid ? attribute::none : row[x].attributes;
+        }
+    }
+}
+
+// Everything that depends on the size of the screen. This is rebuilt when (and only when) the
+// terminal is resized, so that nothing needs to query the screen geometry, recompute per column
+// data or allocate buffers every frame.
+struct screen_buffers
+{
+    int width = 0;
+    int height = 0;
+
+    // the offset along the camera plane (in [-1, 1]) of the ray that is cast for each column, and of the two rays
+    // that are cast for each column in braille (see braille_mode)
+    std::vector<float> ray_offsets;
+    std::vector<float> braille_ray_offsets;
+
+    framebuffer frame;      // the frame that is being rendered
+    framebuffer presented;  // the frame that is currently displayed by the terminal
+
+    explicit screen_buffers(const std::pair<int, int>& screen_size)
+        : width(screen_size.first)
+        , height(screen_size.second)
+        , ray_offsets(static_cast<std::size_t>(std::max(0, width)))
+        , braille_ray_offsets(2 * ray_offsets.size())
+        , frame(width, height)
+        , presented(width, height)
+    {
+        const auto offsets = [](const std::span<float> offsets) {
+            const auto last = static_cast<float>(std::max<std::size_t>(1, offsets.size() - 1));
+            for (std::size_t i = 0; i < offsets.size(); ++i)
+                offsets[i] = (2.0f * static_cast<float>(i) / last) - 1.0f;
+        };
+        offsets(ray_offsets);
+        offsets(braille_ray_offsets);
+    }
+
+    // the ray offsets for the given rendering mode
+    [[nodiscard]] std::span<const float> ray_offsets_for(const render_mode mode) const
+    {
+        return (mode == render_mode::braille) ? braille_ray_offsets : ray_offsets;
+    }
+};
+
+// How the wall hits for the columns are computed
+enum class wall_caster
+{
+    dda,         // cast rays through the grid
+    bsp,         // draw the segments of a BSP tree front to back
+    progressive,  // cast rays through the grid coarse to fine until the ray budget runs out
+    table         // look up the wall faces in a table precomputed for quantized poses
+};
+
+// The next wall caster in the order they are cycled through in the game
+constexpr wall_caster next(const wall_caster caster)
+{
+    switch (caster)
+    {
+    case wall_caster::dda: return wall_caster::bsp;
+    case wall_caster::bsp: return wall_caster::progressive;
+    case wall_caster::progressive: return wall_caster::table;
+    default: return wall_caster::dda;
+    }
+}
+
+// Settings that control how frames are rendered
+struct render_settings
+{
+    render_mode mode = render_mode::smooth;
+    bool is_dithered = false;  // shade solid walls (not textured ones) with dithered density glyphs (see dither_walls)
+    bool is_floor_cast = false;  // draw textured floors and ceilings (see cast_floor_and_ceiling)
+    bool is_map_visible = false;
+    wall_caster caster = wall_caster::dda;
+
+    bool is_metrics_visible = false;
+
+    // only cast a ray every span_width columns if the rays at both ends of the span hit the same wall face
+    // (see compute_wall_hits). The result is the same, but fewer rays are cast. One casts every ray.
+    std::size_t span_width = 8;
+
+    // cast at most every column_step-th ray and reconstruct the columns in between (one is full resolution)
+    std::size_t column_step = 1;
+
+    // the far plane and the step limit for rays (unbounded by default, which is fine for the closed maze).
+    // Walls fade into fog from fog_start (a fraction of the fog distance, see fog_distance) on and beyond the
+    // fog distance there is nothing but fog.
+    ray_limits limits{};
+    float fog_start = 0.5f;
+
+    // how the DDA steps and whether it uses the fast reciprocal (see ray_options)
+    ray_options casting{};
+
+    // the lookup table of the maze for the table wall caster (which casts every ray without one)
+    const wall_hit_table* table = nullptr;
+
+    // the texture of textured walls (the built-in one if there is none, see builtin_wall_texture)
+    const wall_texture* texture = nullptr;
+
+    // the sprites in the world (none if there is no grid, see draw_sprites)
+    const sprite_grid* sprites = nullptr;
+
+    // the instruction set of the kernels that cast rays and encode frames (see kernels_for)
+    isa kernel_isa = isa::baseline;
+
+    // the hard limit on the time spent computing wall hits with the progressive wall caster. Whatever is not
+    // done by then is filled in from the nearest computed column (see compute_wall_hits_progressive).
+    std::chrono::duration<float, std::milli> ray_budget{2.0f};
+};
+
+// What it took to render a frame
+struct frame_stats
+{
+    ray_stats rays;
+    float resolution_scale = 1.0f;  // the fraction of columns that were computed exactly
+
+    sprite_stats sprites;
+
+    // the time spent on drawing the scene, the sprites and on post-processing it
+    std::chrono::duration<float, std::milli> scene_time{};
+    std::chrono::duration<float, std::milli> sprite_time{};
+    std::chrono::duration<float, std::milli> post_process_time{};
+};
+
+// The BSP tree of the wall segments of the built-in maze (built on first use)
+inline const bsp_tree& maze_bsp()
+{
+    static const auto tree = bsp_tree(maze_map{});
+    return tree;
+}
+
+// Draw the columns of the 3D scene in the given mode from the wall hits (Mode::rays_per_cell per column)
+template <typename Mode>
+void draw_walls(framebuffer& frame, const std::span<const wall_hit> hits, const render_settings& settings)
+{
+    // anything beyond the fog distance (and any ray that missed) is drawn as a wall of fog at that distance
+    const auto fog_wall = wall_hit{.distance = fog_distance(settings.limits), .tx = 0.5f};
+    const auto is_bounded = settings.limits.is_bounded();
+
+    if constexpr (Mode::rays_per_cell == 2)
+    {
+        const auto columns = std::min(frame.width(), static_cast<int>(hits.size() / 2));
+        for (int i = 0; i < columns; ++i)
+        {
+            auto column_hits = std::array{hits[2 * i], hits[2 * i + 1]};
+            auto fog = std::array{0.0f, 0.0f};
+            for (std::size_t side = 0; is_bounded and (side < 2); ++side)
+            {
+                fog[side] = fog_amount(column_hits[side].distance, settings.limits, settings.fog_start);
+                if (fog[side] >= 1.0f) column_hits[side] = fog_wall;
+            }
+            draw_braille_column(frame, i, column_hits, fog);
+        }
+    }
+    else
+    {
+        const auto& texture = (settings.texture != nullptr) ? *settings.texture : builtin_wall_texture();
+        const auto draw = [&](const int i, const wall_hit& hit) {
+            if constexpr (Mode::is_textured)
+                draw_textured_column(frame, i, hit, texture);
+            else
+                draw_column<Mode>(frame, i, hit);
+        };
+
+        // without ray limits there is no fog (and every ray hits a wall in the closed maze)
+        if (!is_bounded)
+        {
+            for (int i = 0; i < frame.width(); ++i)
+                draw(i, hits[i]);
+
+            return;
+        }
+
+        for (int i = 0; i < frame.width(); ++i)
+        {
+            const auto fog = fog_amount(hits[i].distance, settings.limits, settings.fog_start);
+            if (fog > 0.0f)
+                draw_column<fog_mode>(frame, i, (fog < 1.0f) ? hits[i] : fog_wall, fog);
+            else
+                draw(i, hits[i]);
+        }
+    }
+}
+
+//  Compute the wall hits with compute(hits, ray_offsets) for every column_step-th column and the last one only
+// and fill in the columns in between from the nearest of those (like compute_span_wall_hits approximates the
+// columns between two rays that hit different faces). This applies the column step of the dynamic resolution to
+// the wall casters that can't skip columns themselves. With a column step of one every column is computed.
+template <typename Compute>
+ray_stats compute_strided_wall_hits(const std::span<wall_hit> hits, const std::span<const float> ray_offsets,
+                                    const std::size_t column_step, frame_arena& arena, const Compute& compute)
+{
+    const auto n = hits.size();
+    if ((column_step <= 1) or (n < 3)) return compute(hits, ray_offsets);
+
+    const auto samples = (n - 2) / column_step + 2;
+    const auto column = [&](const std::size_t sample) { return std::min(sample * column_step, n - 1); };
+    const auto sample_hits = arena.allocate<wall_hit>(samples);
+    const auto sample_offsets = arena.allocate<float>(samples);
+    for (std::size_t sample = 0; sample < samples; ++sample)
+        sample_offsets[sample] = ray_offsets[column(sample)];
+
+    auto stats = compute(sample_hits, std::span<const float>(sample_offsets));
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const auto left = i / column_step;
+        const auto right = std::min(left + 1, samples - 1);
+        hits[i] = sample_hits[(i - column(left) <= column(right) - i) ? left : right];
+    }
+
+    stats.columns = n;
+    stats.columns_approximated += n - samples;
+    return stats;
+}
+
+// Draw the 3D scene in the given mode. First the wall hits for all rays are computed (into a buffer from the
+// frame arena, the ray offsets must be those for the mode, see screen_buffers), then the columns are drawn and
+// then the floor and the ceiling are cast (if they are, not in braille).
+// The wall hits are returned so that later passes can use them.
+template <typename Mode>
+std::pair<std::span<const wall_hit>, ray_stats> draw_scene(framebuffer& frame, const std::span<const float> ray_offsets,
+                                                           const player& plyr, const render_settings& settings,
+                                                           frame_arena& arena)
+{
+    // For each screen column, get the ray direction and compute the wall hit. The DDA casters apply the column
+    // step themselves, the others only compute every column_step-th column (see compute_strided_wall_hits).
+    const auto hits = arena.allocate<wall_hit>(ray_offsets.size());
+    const auto cam = plyr.view();
+    const auto compute_strided = [&](const auto& compute) {
+        return compute_strided_wall_hits(hits, ray_offsets, settings.column_step, arena, compute);
+    };
+    const auto stats = [&] {
+        switch (settings.caster)
+        {
+        // the BSP tree and the table ignore the ray limits, walls beyond the far plane are hidden by the fog below
+        case wall_caster::bsp:
+            return compute_strided([&](const std::span<wall_hit> column_hits, const std::span<const float> offsets) {
+                return maze_bsp().compute_wall_hits(maze_map{}, column_hits, cam, offsets, arena);
+            });
+        case wall_caster::progressive:
+        {
+            const auto deadline = std::chrono::steady_clock::now() +
+                                  std::chrono::duration_cast<std::chrono::steady_clock::duration>(settings.ray_budget);
+            const auto is_over_budget = [deadline] { return std::chrono::steady_clock::now() > deadline; };
+            return compute_strided([&](const std::span<wall_hit> column_hits, const std::span<const float> offsets) {
+                const auto ray_dir = [&](const std::size_t i) { return cam.ray(offsets[i]); };
+                return compute_wall_hits_progressive(maze_map{}, column_hits, cam.pos, ray_dir, settings.span_width,
+                                                     settings.limits, settings.casting, is_over_budget, arena);
+            });
+        }
+        case wall_caster::table:
+            if (settings.table != nullptr)
+            {
+                return compute_strided([&](const std::span<wall_hit> column_hits,
+                                           const std::span<const float> offsets) {
+                    return settings.table->compute_wall_hits(maze_map{}, column_hits, cam, offsets);
+                });
+            }
+            [[fallthrough]];
+        default:
+            return kernels_for(settings.kernel_isa)
+                .compute_maze_wall_hits(hits, cam, ray_offsets, settings.span_width, settings.column_step,
+                                        settings.limits, settings.casting);
+        }
+    }();
+
+    draw_walls<Mode>(frame, hits, settings);
+    if constexpr (Mode::rays_per_cell == 1)
+    {
+        if (settings.is_floor_cast)
+            cast_floor_and_ceiling<Mode>(frame, plyr.view(), fog_distance(settings.limits), arena);
+    }
+
+    return {hits, stats};
+}
+
+// Draw the 3D scene in the rendering mode of the settings
+inline std::pair<std::span<const wall_hit>, ray_stats> draw_scene(framebuffer& frame,
+                                                                  const std::span<const float> ray_offsets,
+                                                                  const player& plyr, const render_settings& settings,
+                                                                  frame_arena& arena)
+{
+    return visit_render_mode(settings.mode, [&]<typename Mode>(Mode) {
+        return draw_scene<Mode>(frame, ray_offsets, plyr, settings, arena);
+    });
+}
+
+inline void draw_map(framebuffer& frame, const player& plyr)
+{
+    // print each line of the map
+    for (auto i = maze_height; const auto line : maze)
+        frame.print(0, --i, line);
+
+    // print the player on the map as a small arrow pointing in the direction that the player
+    // is looking
+    const auto [x, y] = to_vec2i(plyr.pos());
+    const auto dir = (pi / 16.0f) + (to_radians(plyr.line_of_sight(0.5f)) / (pi * 2.0f));
+    const auto dir_index = (7 + static_cast<int>(dir * 8.0f)) % 8;
+    constexpr auto dir_chars =
+        std::array{U'\u25c0', U'\u25e3', U'\u25bc', U'\u25e2', U'\u25b6', U'\u25e5', U'\u25b2', U'\u25e4'};
+    frame.put(x, maze_height - y - 1, dir_chars[dir_index]);
+}
+
+// render the scene (and possibly the map) into the frame buffer
+inline frame_stats render(screen_buffers& screen, const player& plyr, const render_settings& settings,
+                          frame_arena& arena)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const auto ray_offsets = screen.ray_offsets_for(settings.mode);
+    const auto [hits, ray_stats] = draw_scene(screen.frame, ray_offsets, plyr, settings, arena);
+    const auto scene_end = std::chrono::steady_clock::now();
+
+    // sprites and post-processing need one wall hit per column (so not for braille)
+    const auto has_column_hits = (hits.size() == screen.ray_offsets.size());
+    auto sprites = sprite_stats{};
+    if ((settings.sprites != nullptr) and has_column_hits)
+        sprites = draw_sprites(screen.frame, hits, plyr.view(), *settings.sprites, arena);
+    const auto sprite_end = std::chrono::steady_clock::now();
+
+    // textured walls are left alone, since their solid texels look just like solid walls to dither_walls
+    const auto is_dithered = settings.is_dithered and (settings.mode != render_mode::textured);
+    if (is_dithered and has_column_hits) dither_walls(screen.frame, hits, arena);
+    const auto post_process_end = std::chrono::steady_clock::now();
+
+    if (settings.is_map_visible) draw_map(screen.frame, plyr);
+    const auto columns = static_cast<float>(std::max<std::size_t>(1, ray_stats.columns));
+    const auto exact_columns = static_cast<float>(ray_stats.columns - ray_stats.columns_approximated);
+    return {.rays = ray_stats,
+            .resolution_scale = (ray_stats.columns == 0) ? 1.0f : exact_columns / columns,
+            .sprites = sprites,
+            .scene_time = scene_end - start,
+            .sprite_time = sprite_end - scene_end,
+            .post_process_time = post_process_end - sprite_end};
+}
+
+// Print the frame time and what it took to render the frame on the bottom line of the frame buffer
+inline void draw_metrics(framebuffer& frame, const float frame_time_ms, const frame_stats& stats)
+{
+    char text[200];
+    std::snprintf(text, sizeof(text),
+                  " %6.2f ms (scene %.2f, sprites %.2f, post %.2f) | rays %zu/%zu | resolution %.2f | sprites %zu ",
+                  frame_time_ms, stats.scene_time.count(), stats.sprite_time.count(), stats.post_process_time.count(),
+                  stats.rays.rays_cast, stats.rays.columns, stats.resolution_scale, stats.sprites.visible);
+    frame.print(0, frame.height() - 1, text);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+//  Dynamic resolution: watches recent frame times and adjusts the column step (cast a ray only for
+// every nth column and reconstruct the others, see compute_wall_hits) to hold a target frame time.
+// When the average frame time is over budget the step is increased, when there is plenty of headroom
+// it is decreased again. After every change the controller waits a few frames for the average to
+// settle, so that it does not oscillate between two steps.
+class resolution_controller
+{
+public:
+    using milliseconds = std::chrono::duration<float, std::milli>;
+
+    explicit resolution_controller(const milliseconds target_frame_time, const std::size_t max_column_step = 4)
+        : target_(target_frame_time)
+        , max_column_step_(std::max<std::size_t>(1, max_column_step))
+    {
+    }
+
+    // Feed the time the last frame took and return the column step to use for the next frame
+    std::size_t update(const milliseconds frame_time)
+    {
+        average_ = (average_.count() == 0.0f) ? frame_time : average_ + (frame_time - average_) * smoothing;
+
+        if (cooldown_ > 0)
+        {
+            --cooldown_;
+        }
+        else if ((average_ > target_) and (column_step_ < max_column_step_))
+        {
+            ++column_step_;
+            cooldown_ = settle_frames;
+        }
+        else if ((average_ < target_ * headroom) and (column_step_ > 1))
+        {
+            --column_step_;
+            cooldown_ = settle_frames;
+        }
+
+        return column_step_;
+    }
+
+    [[nodiscard]] std::size_t column_step() const { return column_step_; }
+    [[nodiscard]] milliseconds average_frame_time() const { return average_; }
+    [[nodiscard]] milliseconds target_frame_time() const { return target_; }
+
+private:
+    constexpr static float smoothing = 0.1f;  // weight of the latest frame in the moving average
+    constexpr static float headroom = 0.6f;   // only increase the resolution below this fraction of the target
+    constexpr static int settle_frames = 15;
+
+    milliseconds target_;
+    std::size_t max_column_step_;
+    std::size_t column_step_ = 1;
+    milliseconds average_{0.0f};
+    int cooldown_ = 0;
+};
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <frame_arena.hpp>
+#include <framebuffer.hpp>
+#include <math.hpp>
+#include <raycaster.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+//  Billboard sprites: things in the world other than walls (pickups, markers, other players) that are drawn as
+// upright rectangles of a glyph that always face the camera and stand on the floor. A frame of sprites goes
+// through a pipeline (see draw_sprites):
+//
+//  1. culling: only the sprites in the cells of a spatial grid (see sprite_grid) that overlap the view frustum are
+//     projected onto the screen, and of those only the ones that are on the screen and in front of the farthest
+//     wall are kept (see cull_sprites)
+//  2. sorting: the visible sprites are sorted from far to near by a radix sort of their depths (see sort_by_depth),
+//     so that nearer sprites are drawn over farther ones
+//  3. drawing: the columns that a sprite spans are clipped to the screen and every column is drawn only if the wall
+//     of that column is farther away than the sprite, the depth test against the wall hits of the frame
+//     (see draw_projected_sprites)
+
+struct sprite
+{
+    vec2f pos{};
+    float size = 0.5f;  // the height and width in map cells (a cell of wall is 1)
+    char32_t glyph = U'*';
+    std::uint8_t color = 0;
+};
+
+// The largest sprite size that culling allows for (sprite_grid clamps sizes to it)
+constexpr float max_sprite_size = 1.0f;
+
+//  The sprites of a map bucketed by the cell of the map that they are in. The sprites are stored ordered by cell
+// (a counting sort), so the sprites of a cell are a contiguous range and the grid is just the start of the range
+// of every cell. Sprites outside of the map are put into the nearest cell on its border. Building the grid is
+// linear in the number of sprites, so moving sprites can rebuild it every frame.
+class sprite_grid
+{
+public:
+    template <typename Map>
+    sprite_grid(const Map& map, const std::span<const sprite> sprites)
+        : width_(std::max(1, map.width()))
+        , height_(std::max(1, map.height()))
+        , cell_begin_(static_cast<std::size_t>(width_ * height_) + 1)
+        , sprites_(sprites.size())
+    {
+        for (const auto& s : sprites)
+            ++cell_begin_[cell_index(s.pos) + 1];
+        for (std::size_t i = 1; i < cell_begin_.size(); ++i)
+            cell_begin_[i] += cell_begin_[i - 1];
+
+        auto next = std::vector<std::uint32_t>(cell_begin_.begin(), cell_begin_.end() - 1);
+        for (const auto& s : sprites)
+        {
+            auto& placed = sprites_[next[cell_index(s.pos)]++];
+            placed = s;
+            placed.size = std::clamp(s.size, 0.0f, max_sprite_size);
+        }
+    }
+
+    [[nodiscard]] int width() const { return width_; }
+    [[nodiscard]] int height() const { return height_; }
+    [[nodiscard]] std::size_t size() const { return sprites_.size(); }
+
+    // All sprites (ordered by cell)
+    [[nodiscard]] std::span<const sprite> sprites() const { return sprites_; }
+
+    // The range of sprites() of the sprites in a cell
+    [[nodiscard]] std::pair<std::uint32_t, std::uint32_t> cell_range(const vec2i& cell) const
+    {
+        const auto i = static_cast<std::size_t>(cell.y * width_ + cell.x);
+        return {cell_begin_[i], cell_begin_[i + 1]};
+    }
+
+private:
+    [[nodiscard]] std::size_t cell_index(const vec2f& pos) const
+    {
+        // (the comparisons are negated so that NaNs end up in the first cell)
+        const auto x = !(pos.x >= 0.0f) ? 0 : std::min(static_cast<int>(std::min(pos.x, 1e9f)), width_ - 1);
+        const auto y = !(pos.y >= 0.0f) ? 0 : std::min(static_cast<int>(std::min(pos.y, 1e9f)), height_ - 1);
+        return static_cast<std::size_t>(y * width_ + x);
+    }
+
+    int width_;
+    int height_;
+    std::vector<std::uint32_t> cell_begin_;  // per cell and one past the last
+    std::vector<sprite> sprites_;
+};
+
+// A sprite as seen from the camera
+struct projected_sprite
+{
+    float depth;          // along the forward vector of the camera, like the distances of wall hits
+    float center;         // the screen column
+    float half_width;     // in columns
+    std::uint32_t index;  // into sprite_grid::sprites
+};
+
+//  The transform from the map onto a screen that is columns wide, for a camera. A point relative to the camera is
+// depth * forward + depth * offset * right (offset being the position on the camera plane, see basic_camera), so
+// its depth and offset are found with the inverse of the matrix of the two vectors.
+struct sprite_projection
+{
+    // sprites closer than this are not drawn (the player walks through them instead of having the screen filled)
+    static constexpr float near_plane = 0.3f;
+
+    camera cam;
+    float inverse_determinant;
+    float half_columns;  // the columns per unit of offset
+    float right_length;
+
+    sprite_projection(const camera& c, const int columns)
+        : cam(c)
+        , inverse_determinant(1.0f / (c.forward.x * c.right.y - c.forward.y * c.right.x))
+        , half_columns(0.5f * static_cast<float>(std::max(1, columns - 1)))
+        , right_length(std::hypot(c.right.x, c.right.y))
+    {
+    }
+
+    // The depth and the offset times the depth of a point on the map
+    [[nodiscard]] std::pair<float, float> to_camera(const vec2f& p) const
+    {
+        const auto d = p - cam.pos;
+        return {(d.x * cam.right.y - d.y * cam.right.x) * inverse_determinant,
+                (cam.forward.x * d.y - cam.forward.y * d.x) * inverse_determinant};
+    }
+
+    // The sprite on the screen. A sprite is a map cell wide at a size of 1 (like a wall of one cell), so the
+    // columns that it spans scale like those of walls.
+    [[nodiscard]] projected_sprite operator()(const sprite& s, const std::uint32_t index) const
+    {
+        const auto [depth, lateral] = to_camera(s.pos);
+        const auto inverse_depth = 1.0f / depth;
+        return {.depth = depth,
+                .center = (lateral * inverse_depth + 1.0f) * half_columns,
+                .half_width = 0.5f * s.size * half_columns * inverse_depth / right_length,
+                .index = index};
+    }
+};
+
+//  Cull the sprites of the grid for a camera on a screen that is columns wide, where nothing is visible beyond far
+// (the farthest wall). The cells of the grid that overlap the bounding box of the view frustum (the triangle of
+// the camera and the points of the leftmost and the rightmost ray at the far distance) are tested against the
+// frustum, grown by half the largest sprite size so that sprites that stick out of their cell are not lost, and
+// the sprites in the cells that pass are projected and kept if they are between the near plane and far and
+// overlap the screen. The visible sprites are in memory from the arena.
+struct culled_sprites
+{
+    std::span<projected_sprite> visible;
+    std::size_t candidates;  // the sprites in the cells that passed
+};
+
+inline culled_sprites cull_sprites(const sprite_grid& grid, const camera& cam, float far, const int columns,
+                                   frame_arena& arena)
+{
+    const auto projection = sprite_projection(cam, columns);
+    const auto visible = arena.allocate<projected_sprite>(grid.size());
+    auto num_visible = std::size_t{0};
+    auto num_candidates = std::size_t{0};
+
+    // nothing is farther away than the far corner of the grid
+    const auto margin = 0.5f * max_sprite_size;
+    far = std::min(far, std::hypot(static_cast<float>(grid.width()), static_cast<float>(grid.height())) + 1.0f);
+    const auto left = cam.pos + cam.ray(-1.0f) * far;
+    const auto right = cam.pos + cam.ray(1.0f) * far;
+    const auto first = [&](const float a, const float b, const float c) {
+        return std::max(0, static_cast<int>(std::floor(std::min({a, b, c}) - margin)));
+    };
+    const auto last = [&](const float a, const float b, const float c, const int size) {
+        return std::min(size - 1, static_cast<int>(std::floor(std::max({a, b, c}) + margin)));
+    };
+    const auto x_first = first(cam.pos.x, left.x, right.x);
+    const auto x_last = last(cam.pos.x, left.x, right.x, grid.width());
+    const auto y_first = first(cam.pos.y, left.y, right.y);
+    const auto y_last = last(cam.pos.y, left.y, right.y, grid.height());
+
+    const auto sprites = grid.sprites();
+    for (int y = y_first; y <= y_last; ++y)
+    {
+        for (int x = x_first; x <= x_last; ++x)
+        {
+            const auto [begin, end] = grid.cell_range({x, y});
+            if (begin == end) continue;
+
+            // a cell (grown by the margin) is outside of the frustum if all of its corners are behind the camera,
+            // beyond the far distance or on the outer side of the left or the right edge of the view
+            auto outside = std::array{true, true, true, true};
+            for (const auto& [cx, cy] : {std::pair{0.0f, 0.0f}, {1.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}})
+            {
+                const auto corner = vec2f{static_cast<float>(x) + cx * (1.0f + 2.0f * margin) - margin,
+                                          static_cast<float>(y) + cy * (1.0f + 2.0f * margin) - margin};
+                const auto [depth, lateral] = projection.to_camera(corner);
+                outside[0] = outside[0] and (depth < sprite_projection::near_plane);
+                outside[1] = outside[1] and (depth > far + margin);
+                outside[2] = outside[2] and (lateral < -depth);
+                outside[3] = outside[3] and (lateral > depth);
+            }
+            if (std::ranges::any_of(outside, [](const bool b) { return b; })) continue;
+
+            num_candidates += end - begin;
+            for (auto i = begin; i < end; ++i)
+            {
+                const auto p = projection(sprites[i], i);
+                const auto is_visible = (p.depth >= sprite_projection::near_plane) and (p.depth <= far) and
+                                        (p.center + p.half_width >= 0.0f) and
+                                        (p.center - p.half_width < static_cast<float>(columns));
+                if (is_visible) visible[num_visible++] = p;
+            }
+        }
+    }
+
+    return {visible.first(num_visible), num_candidates};
+}
+
+//  Sort projected sprites from far to near: a least significant digit radix sort of the bits of the depths (which
+// are positive, so their bits order like the depths do, and are inverted to sort in descending order), a byte per
+// pass. The histograms of all four passes are counted in one go and passes where all sprites have the same byte
+// are skipped (typically the highest one, as the depths are within a few powers of two). The buffer must be at least
+// as large as sprites.
+inline void sort_by_depth(std::span<projected_sprite> sprites, const std::span<projected_sprite> buffer)
+{
+    if (sprites.size() < 2) return;
+
+    const auto key = [](const projected_sprite& s) { return ~std::bit_cast<std::uint32_t>(s.depth); };
+    auto histograms = std::array<std::array<std::uint32_t, 256>, 4>{};
+    for (const auto& s : sprites)
+    {
+        const auto k = key(s);
+        for (std::size_t pass = 0; pass < 4; ++pass)
+            ++histograms[pass][(k >> (8 * pass)) & 0xff];
+    }
+
+    auto from = sprites;
+    auto to = buffer.first(sprites.size());
+    for (std::size_t pass = 0; pass < 4; ++pass)
+    {
+        auto& counts = histograms[pass];
+        if (std::ranges::find(counts, static_cast<std::uint32_t>(sprites.size())) != counts.end()) continue;
+
+        auto offset = std::uint32_t{0};
+        for (auto& count : counts)
+            offset += std::exchange(count, offset);
+
+        for (const auto& s : from)
+            to[counts[(key(s) >> (8 * pass)) & 0xff]++] = s;
+        std::swap(from, to);
+    }
+
+    if (from.data() != sprites.data()) std::ranges::copy(from, sprites.begin());
+}
+
+//  Draw the projected sprites of the grid in order (far to near) on top of the walls, with the wall hits of the
+// frame (one per column). A sprite stands on the floor at its depth (whose row is where the bottom of a wall at
+// that depth is) and covers the cells whose centers it covers. Its columns are clipped to the screen and each of
+// them is only drawn if the wall of the column is behind the sprite. Returns the number of columns drawn.
+inline std::size_t draw_projected_sprites(framebuffer& frame, const std::span<const wall_hit> hits,
+                                          const std::span<const projected_sprite> sorted, const sprite_grid& grid)
+{
+    const auto columns = std::min(frame.width(), static_cast<int>(hits.size()));
+    const auto height = static_cast<float>(frame.height());
+    const auto sprites = grid.sprites();
+    auto num_columns = std::size_t{0};
+    for (const auto& p : sorted)
+    {
+        const auto& s = sprites[p.index];
+        const auto bottom = 0.5f * (height + height / p.depth);
+        const auto top = bottom - s.size * height / p.depth;
+        const auto cell_rows = [&](const float y) {
+            return std::clamp(static_cast<int>(std::ceil(y - 0.5f)), 0, frame.height());
+        };
+        const auto y_begin = cell_rows(top);
+        const auto y_end = cell_rows(bottom);
+        const auto x_begin = std::clamp(static_cast<int>(std::ceil(p.center - p.half_width - 0.5f)), 0, columns);
+        const auto x_end = std::clamp(static_cast<int>(std::ceil(p.center + p.half_width - 0.5f)), x_begin, columns);
+        if (y_begin == y_end) continue;
+
+        for (int x = x_begin; x < x_end; ++x)
+        {
+            if (hits[static_cast<std::size_t>(x)].distance <= p.depth) continue;
+
+            frame.fill_column(x, y_begin, y_end, {s.glyph, attribute::none, s.color});
+            ++num_columns;
+        }
+    }
+    return num_columns;
+}
+
+// What it took to draw the sprites of a frame
+struct sprite_stats
+{
+    std::size_t candidates = 0;  // the sprites in the cells of the grid in the view frustum
+    std::size_t visible = 0;     // the sprites on the screen in front of the farthest wall
+    std::size_t columns = 0;     // the sprite columns that passed the depth test
+};
+
+// Cull, sort and draw the sprites of the grid for a frame with the given wall hits (one per column)
+inline sprite_stats draw_sprites(framebuffer& frame, const std::span<const wall_hit> hits, const camera& cam,
+                                 const sprite_grid& grid, frame_arena& arena)
+{
+    // nothing is visible behind the farthest wall
+    auto far = 0.0f;
+    for (const auto& hit : hits)
+        far = std::max(far, hit.distance);
+
+    // (the sort buffer is as large as the grid, so that the arena does not grow with the number of visible sprites)
+    const auto [visible, candidates] = cull_sprites(grid, cam, far, frame.width(), arena);
+    sort_by_depth(visible, arena.allocate<projected_sprite>(grid.size()));
+    return {.candidates = candidates,
+            .visible = visible.size(),
+            .columns = draw_projected_sprites(frame, hits, visible, grid)};
+}
+
+//  Scatter sprites over the empty cells of a map: a mix of small pickups, markers and other players (at a random
+// position in a random empty cell, always the same ones for the same seed). The map must have an empty cell.
+template <typename Map>
+std::vector<sprite> scatter_sprites(const Map& map, const std::size_t count, const unsigned seed = 1)
+{
+    constexpr auto kinds = std::array{sprite{.size = 0.25f, .glyph = U'$', .color = 2},
+                                      sprite{.size = 0.5f, .glyph = U'!', .color = 3},
+                                      sprite{.size = 0.8f, .glyph = U'@', .color = 1}};
+    auto sprites = std::vector<sprite>();
+    auto random = std::mt19937(seed);
+    auto x = std::uniform_int_distribution(0, map.width() - 1);
+    auto y = std::uniform_int_distribution(0, map.height() - 1);
+    auto within = std::uniform_real_distribution(0.2f, 0.8f);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto cell = vec2i{x(random), y(random)};
+        while (map.is_wall(cell))
+            cell = {x(random), y(random)};
+
+        auto s = kinds[i % kinds.size()];
+        s.pos = {static_cast<float>(cell.x) + within(random), static_cast<float>(cell.y) + within(random)};
+        sprites.push_back(s);
+    }
+    return sprites;
+}
@@ -1,7 +1,16 @@
 #pragma once
 
+#include <encoder.hpp>
+
 #include <ncurses.h>
-#include <string>
+#include <span>
+#include <string_view>
+
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
 
 namespace os
 {
@@ -18,34 +27,122 @@ namespace os
             keypad(stdscr, true);
             nodelay(stdscr, true);
             curs_set(0);
+            init_shades();
+
+            install_resize_handler();
+            getmaxyx(stdscr, size_.second, size_.first);
         }
 
         ~terminal()
         {
+            remove_resize_handler();
             endwin();
         }
 
-        void print(const int x, const int y, const wchar_t* s) const
-        {
-            mvaddwstr(y, x, s);
-        }
+        terminal(const terminal&) = delete;
+        terminal& operator=(const terminal&) = delete;
 
-        void print_char(const int x, const int y, const char* c, const bool is_reversed = false) const
+        // print a run of UTF-8 text with the given attributes and color
+        void print(const int x, const int y, const std::string_view s, const std::uint8_t attributes,
+                   const std::uint8_t color = 0) const
         {
+            const auto is_reversed = (attributes & attribute::reversed) != 0;
+            const auto color_pair = has_shades_ ? COLOR_PAIR(color) : 0;
             if (is_reversed)
                 attron(A_REVERSE);
+            if (color_pair != 0)
+                attron(color_pair);
 
-            mvaddstr(y, x, c);
+            mvaddnstr(y, x, s.data(), static_cast<int>(s.size()));
 
+            if (color_pair != 0)
+                attroff(color_pair);
             if (is_reversed)
                 attroff(A_REVERSE);
         }
 
-        auto screen_size() const
+        // send the encoded changes of a frame to the terminal
+        void draw(const std::span<const text_run> runs) const
         {
-            std::pair<int, int> result;
-            getmaxyx(stdscr, result.second, result.first);
-            return result;
+            for (const auto& run : runs)
+                print(run.x, run.y, run.text, run.attributes, run.color);
         }
+
+        // The (width, height) of the screen as of the last call to poll_resize
+        [[nodiscard]] auto screen_size() const { return size_; }
+
+        //  Returns true if the terminal was resized since the last call, in which case screen_size
+        // has been updated and anything that depends on the screen size needs to be rebuilt. A burst
+        // of resize signals between two calls is reported as a single resize.
+        bool poll_resize()
+        {
+            auto is_resized = false;
+            for (char c = 0; read(resize_pipe[0], &c, 1) == 1;)
+                is_resized = true;
+
+            if (is_resized)
+            {
+                if (winsize ws{}; ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0) resizeterm(ws.ws_row, ws.ws_col);
+                getmaxyx(stdscr, size_.second, size_.first);
+                clear();
+            }
+
+            return is_resized;
+        }
+
+    private:
+        //  The shades (the colors 1 to num_shades of cells) are color pairs of the greys of the 256 color palette
+        // (from 255, the brightest, down) on the default background. Terminals with fewer colors get no shading.
+        void init_shades()
+        {
+            if (!has_colors() or (start_color() != OK) or (COLORS < 256)) return;
+
+            use_default_colors();
+            for (short shade = 1; shade <= num_shades; ++shade)
+                init_pair(shade, static_cast<short>(255 - 4 * (shade - 1)), -1);
+            has_shades_ = true;
+        }
+
+        //  Resizes are signalled with SIGWINCH. The handler only writes a byte to a non-blocking pipe
+        // (the self-pipe trick) which is drained by poll_resize on the render thread, so that there is
+        // no need to query the screen geometry every frame.
+        static void install_resize_handler()
+        {
+            if (pipe(resize_pipe) != 0) return;
+            for (const auto fd : resize_pipe)
+            {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+            }
+
+            struct sigaction action = {};
+            action.sa_handler = [](int) {
+                const auto saved_errno = errno;
+                [[maybe_unused]] const auto result = write(resize_pipe[1], "r", 1);
+                errno = saved_errno;
+            };
+            sigemptyset(&action.sa_mask);
+            action.sa_flags = SA_RESTART;
+            sigaction(SIGWINCH, &action, &previous_resize_action);
+        }
+
+        // Restore the handler of SIGWINCH from before install_resize_handler and close the pipe
+        static void remove_resize_handler()
+        {
+            if (resize_pipe[0] < 0) return;
+
+            sigaction(SIGWINCH, &previous_resize_action, nullptr);
+            for (auto& fd : resize_pipe)
+            {
+                close(fd);
+                fd = -1;
+            }
+        }
+
+        static inline int resize_pipe[2] = {-1, -1};
+        static inline struct sigaction previous_resize_action = {};
+
+        std::pair<int, int> size_;
+        bool has_shades_ = false;
     };
 }
\ No newline at end of file
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <framebuffer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+//  Wall textures of glyphs and colors (see cell and textured_mode). Each texel is drawn like a wall cell (with the
+// reversed attribute, so a space is solid and other glyphs are cut out of the wall) in its color. Textures of the
+// floor and the ceiling (see cast_floor_and_ceiling) are drawn without attributes. A texture is
+// stored as vertical stripes (the texels of a column of the texture next to each other), so that drawing a column
+// of a wall reads one contiguous stripe, and with a chain of mip levels that halve the size of the previous level
+// down to a single texel. A wall is drawn from the smallest level that still has at least as many rows as the wall
+// is high (see level_for), so distant walls show what the texture looks like from afar instead of a sparse pick of
+// texels that changes with every step the player takes.
+//
+// Texture files are UTF-8 text: the rows of glyphs, optionally followed by a line with just "--" and as many rows
+// of colors, a digit per glyph (0 is the default color of the terminal and 1 to num_shades the shades of grey).
+// Short rows are padded with spaces (and the default color) and lines starting with '#' are comments.
+class wall_texture
+{
+public:
+    //  The texture with the given rows of glyphs and colors (see above) and the attributes of all texels. There
+    // is nothing without glyphs and anything that is not a digit up to num_shades is the default color.
+    [[nodiscard]] static std::optional<wall_texture> from_rows(const std::span<const std::u32string> glyphs,
+                                                               const std::span<const std::string> colors = {},
+                                                               const std::uint8_t attributes = attribute::reversed)
+    {
+        auto width = std::size_t{0};
+        for (const auto& row : glyphs)
+            width = std::max(width, row.size());
+        if ((width == 0) or (width > max_size) or (glyphs.size() > max_size)) return std::nullopt;
+
+        auto texture = wall_texture();
+        const auto height = glyphs.size();
+        texture.levels_.push_back({static_cast<int>(width), static_cast<int>(height), 0});
+        texture.texels_.resize(width * height);
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+            {
+                const auto glyph = (x < glyphs[y].size()) ? glyphs[y][x] : U' ';
+                const auto digit = ((y < colors.size()) and (x < colors[y].size())) ? colors[y][x] - '0' : 0;
+                const auto color = ((digit >= 0) and (digit <= num_shades)) ? digit : 0;
+                texture.texels_[x * height + y] = {glyph, attributes, static_cast<std::uint8_t>(color)};
+            }
+        }
+
+        texture.build_mip_levels();
+        return texture;
+    }
+
+    // Load a texture file (see above). Loading fails (and returns nothing) if there is no such file or no glyphs.
+    [[nodiscard]] static std::optional<wall_texture> load(const char* path)
+    {
+        auto* file = std::fopen(path, "rb");
+        if (file == nullptr) return std::nullopt;
+
+        auto text = std::string();
+        auto buffer = std::array<char, 4096>{};
+        for (auto n = std::size_t{0}; (n = std::fread(buffer.data(), 1, buffer.size(), file)) > 0;)
+            text.append(buffer.data(), n);
+        std::fclose(file);
+
+        auto glyphs = std::vector<std::u32string>();
+        auto colors = std::vector<std::string>();
+        auto is_color = false;
+        for (auto rest = std::string_view(text); !rest.empty();)
+        {
+            const auto end = std::min(rest.find('\n'), rest.size());
+            auto line = rest.substr(0, end);
+            rest.remove_prefix(std::min(end + 1, rest.size()));
+            if (line.ends_with('\r')) line.remove_suffix(1);
+
+            if (line.starts_with('#')) continue;
+            if (line == "--")
+                is_color = true;
+            else if (is_color)
+                colors.emplace_back(line);
+            else
+                glyphs.push_back(decode_utf8(line));
+        }
+
+        return from_rows(glyphs, colors);
+    }
+
+    // The size of the texture (of the first mip level)
+    [[nodiscard]] int width() const { return levels_.front().width; }
+    [[nodiscard]] int height() const { return levels_.front().height; }
+
+    [[nodiscard]] std::size_t num_levels() const { return levels_.size(); }
+
+    // The mip level to draw a wall that is wall_height cells high (not truncated) from
+    [[nodiscard]] std::size_t level_for(const float wall_height) const
+    {
+        auto level = std::size_t{0};
+        while ((level + 1 < levels_.size()) and (static_cast<float>(levels_[level + 1].height) >= wall_height))
+            ++level;
+
+        return level;
+    }
+
+    // The size (width, height) of a mip level and its texels column by column (texel (u, v) is at u * height + v)
+    [[nodiscard]] std::pair<int, int> level_size(const std::size_t level) const
+    {
+        return {levels_[level].width, levels_[level].height};
+    }
+    [[nodiscard]] std::span<const cell> texels(const std::size_t level) const
+    {
+        const auto& l = levels_[level];
+        return {texels_.data() + l.offset, static_cast<std::size_t>(l.width * l.height)};
+    }
+
+    // The column of texels of the given mip level at texture coordinate tx (in [0, 1]) from top to bottom
+    [[nodiscard]] std::span<const cell> stripe(const std::size_t level, const float tx) const
+    {
+        const auto& l = levels_[level];
+        const auto u = std::clamp(static_cast<int>(tx * static_cast<float>(l.width)), 0, l.width - 1);
+        const auto height = static_cast<std::size_t>(l.height);
+        return {texels_.data() + l.offset + static_cast<std::size_t>(u) * height, height};
+    }
+
+private:
+    // Textures larger than this in either direction are rejected (which keeps the texture rows of a wall column
+    // in range of the fixed point stepping of draw_textured_column)
+    constexpr static std::size_t max_size = 1024;
+
+    struct mip_level
+    {
+        int width;
+        int height;
+        std::size_t offset;  // of the first texel in texels_
+    };
+
+    wall_texture() = default;
+
+    //  Add the levels below the first one. Each texel of a level is the most common of the (up to) 2x2 texels
+    // that it covers of the level above, because glyphs can't be averaged. Ties go to the texel that is more
+    // common in the whole level above, so that thin details (like the mortar between bricks) don't take over the
+    // smaller levels.
+    void build_mip_levels()
+    {
+        while ((levels_.back().width > 1) or (levels_.back().height > 1))
+        {
+            const auto above = levels_.back();
+            const auto key = [](const cell& c) { return std::tuple(c.glyph, c.attributes, c.color); };
+            auto sorted = std::vector<cell>(texels_.begin() + static_cast<std::ptrdiff_t>(above.offset), texels_.end());
+            std::ranges::sort(sorted, {}, key);
+            const auto frequency = [&](const cell& c) {
+                return std::ranges::equal_range(sorted, key(c), {}, key).size();
+            };
+
+            const auto level = mip_level{(above.width + 1) / 2, (above.height + 1) / 2, texels_.size()};
+            texels_.resize(texels_.size() + static_cast<std::size_t>(level.width * level.height));
+
+            const auto texel = [&](const int x, const int y) {
+                const auto cx = std::min(x, above.width - 1);
+                const auto cy = std::min(y, above.height - 1);
+                return texels_[above.offset + static_cast<std::size_t>(cx * above.height + cy)];
+            };
+            for (int x = 0; x < level.width; ++x)
+            {
+                for (int y = 0; y < level.height; ++y)
+                {
+                    const auto block = std::array{texel(2 * x, 2 * y), texel(2 * x + 1, 2 * y),
+                                                  texel(2 * x, 2 * y + 1), texel(2 * x + 1, 2 * y + 1)};
+                    const auto most_common = std::ranges::max_element(block, {}, [&](const cell& c) {
+                        return std::pair(std::ranges::count(block, c), frequency(c));
+                    });
+                    texels_[level.offset + static_cast<std::size_t>(x * level.height + y)] = *most_common;
+                }
+            }
+            levels_.push_back(level);
+        }
+    }
+
+    // The code points of UTF-8 text (anything malformed is the replacement character)
+    static std::u32string decode_utf8(const std::string_view text)
+    {
+        auto decoded = std::u32string();
+        for (std::size_t i = 0; i < text.size();)
+        {
+            const auto lead = static_cast<unsigned char>(text[i++]);
+            auto length = (lead < 0x80) ? 0 : (lead >= 0xf0) ? 3 : (lead >= 0xe0) ? 2 : (lead >= 0xc0) ? 1 : -1;
+            auto code_point = (length <= 0) ? char32_t{lead} : char32_t{lead & (0x3fu >> length)};
+            for (int n = 0; n < length; ++n, ++i)
+            {
+                if ((i >= text.size()) or ((static_cast<unsigned char>(text[i]) & 0xc0) != 0x80))
+                {
+                    length = -1;
+                    break;
+                }
+                code_point = (code_point << 6) | (static_cast<unsigned char>(text[i]) & 0x3fu);
+            }
+            decoded.push_back((length < 0) ? U'\ufffd' : code_point);
+        }
+        return decoded;
+    }
+
+    std::vector<mip_level> levels_;
+    std::vector<cell> texels_;  // all levels, each stored as vertical stripes
+};
+
+// The texture that textured walls are drawn with unless another one is loaded: bricks in two shades (built on
+// first use)
+inline const wall_texture& builtin_wall_texture()
+{
+    static const auto texture = [] {
+        // '_' is the mortar between rows of bricks (a lower one eighth block) and '|' between bricks (a light
+        // vertical line)
+        constexpr auto rows = std::array<std::string_view, 8>{"________________", "       |        ",
+                                                              "       |        ", "________________",
+                                                              "|               ", "|               ",
+                                                              "________________", "   |       |    "};
+        const auto colors = std::array<std::string, 8>{"2222222222222222", "1111111211111111", "1111111211111111",
+                                                       "2222222222222222", "2111111111111111", "2111111111111111",
+                                                       "2222222222222222", "1112111111121111"};
+        auto glyphs = std::array<std::u32string, rows.size()>{};
+        for (std::size_t y = 0; y < rows.size(); ++y)
+            for (const auto c : rows[y])
+                glyphs[y].push_back((c == '_') ? U'\u2581' : (c == '|') ? U'\u2502' : static_cast<char32_t>(c));
+
+        return *wall_texture::from_rows(glyphs, colors);
+    }();
+    return texture;
+}
+
+//  The textures of the floor and the ceiling (built on first use), one per cell of the map: floor tiles with a
+// few pebbles and beams across the ceiling. Their sizes are powers of two (see cast_floor_and_ceiling).
+inline const wall_texture& builtin_floor_texture()
+{
+    static const auto texture = [] {
+        const auto glyphs = std::array<std::u32string, 8>{U"::::::::", U":   .   ", U":       ", U": .   . ",
+                                                          U":       ", U":   .   ", U":       ", U":     . "};
+        const auto colors = std::array<std::string, 8>{"33333333", "31111111", "31111111", "31111111",
+                                                       "31111111", "31111111", "31111111", "31111111"};
+        return *wall_texture::from_rows(glyphs, colors, attribute::none);
+    }();
+    return texture;
+}
+
+inline const wall_texture& builtin_ceiling_texture()
+{
+    static const auto texture = [] {
+        const auto glyphs = std::array<std::u32string, 4>{U"========", U"        ", U"        ", U"        "};
+        const auto colors = std::array<std::string, 4>{"44444444"};
+        return *wall_texture::from_rows(glyphs, colors, attribute::none);
+    }();
+    return texture;
+}
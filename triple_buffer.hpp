@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+//  A lock-free triple buffer for handing snapshots from exactly one producer thread to exactly one
+// consumer thread. The producer always owns one slot (back), the consumer always owns one slot (front)
+// and the third slot (middle) is shared. Publishing swaps back and middle and marks the middle slot
+// as fresh, picking up the latest snapshot swaps front and middle if it is fresh. Neither side ever
+// waits for the other, and the consumer always sees the most recently published snapshot.
+template <typename T>
+class triple_buffer
+{
+public:
+    // Producer: the slot to write the next snapshot into
+    [[nodiscard]] T& back() { return slots_[back_].value; }
+
+    // Producer: make the snapshot in the back slot available to the consumer
+    void publish() { back_ = middle_.exchange(back_ | fresh_bit, std::memory_order_acq_rel) & index_mask; }
+
+    // Consumer: the most recently published snapshot (or the previous one if nothing new was published)
+    [[nodiscard]] const T& latest()
+    {
+        if (middle_.load(std::memory_order_relaxed) & fresh_bit)
+            front_ = middle_.exchange(front_, std::memory_order_acq_rel) & index_mask;
+        return slots_[front_].value;
+    }
+
+private:
+    // keep the slots on separate cache lines so that the producer writing the back slot does
+    // not invalidate the consumer's front slot
+    struct alignas(64) slot
+    {
+        T value{};
+    };
+
+    constexpr static std::uint8_t index_mask = 0b011;
+    constexpr static std::uint8_t fresh_bit = 0b100;
+
+    std::array<slot, 3> slots_{};
+    alignas(64) std::uint8_t back_ = 0;
+    alignas(64) std::atomic<std::uint8_t> middle_ = 1;
+    alignas(64) std::uint8_t front_ = 2;
+};
+
+//  A bounded lock-free single producer/single consumer ring used to forward small values (e.g. key
+// presses) between threads. Pushing to a full ring drops the value rather than blocking.
+template <typename T, std::size_t Capacity>
+class spsc_ring
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    bool push(const T& value)
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == Capacity) return false;
+        values_[head & (Capacity - 1)] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value)
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return false;
+        value = values_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> values_{};
+    alignas(64) std::atomic<std::size_t> head_ = 0;
+    alignas(64) std::atomic<std::size_t> tail_ = 0;
+};
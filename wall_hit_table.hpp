@@ -0,0 +1,334 @@
+#pragma once
+
+#include <math.hpp>
+#include <raycaster.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+//  Raycasting by table lookup for small static maps. For every empty cell the map is sampled at
+// positions_per_cell x positions_per_cell positions (on a grid that includes the edges of the cell) and for
+// each of those at num_angles ray directions, and the wall face that the ray from the sample position in the
+// sample direction hits is stored (two bytes per entry). A lookup fetches the faces of the eight samples around
+// the pose (the two nearest angles at each of the four sample positions around the position) and if they all
+// hit the same face, intersects the actual ray with it, so the distance and texture coordinate are those of the
+// exact computation. The rays in between the samples can't miss that face: at the distances of a small map the
+// samples are much less than a cell apart, so no wall cell fits in between them without blocking one of them.
+// Wherever the samples disagree (close to the corners and edges of walls) the ray falls back to the DDA, and so
+// does a ray that doesn't land on the face (which would only happen for a sample that grazes a corner).
+//
+// Directions are quantized by their "diamond angle" (the position on the unit diamond |x| + |y| = 1,
+// which is monotonic in the angle but only needs a division) instead of by the angle itself, so a lookup
+// does not need any trigonometry. The entries of one sample position are stored next to each other
+// ordered by angle, so the rays of one frame read contiguous runs of the table.
+class wall_hit_table
+{
+public:
+    // Maps with more cells than this can't be stored (face entries are 15 bit cell indices plus a bit for
+    // is_x). A table for such a map is empty and every lookup falls back to the DDA.
+    constexpr static std::size_t max_cells = 1 << 15;
+
+    template <typename Map>
+    explicit wall_hit_table(const Map& map, const int positions_per_cell = 8, const int num_angles = 1024)
+        : width_(map.width())
+        , height_(map.height())
+        , positions_per_cell_(std::max(1, positions_per_cell))
+        , num_angles_(std::max(4, num_angles))
+    {
+        const auto num_cells = static_cast<std::size_t>(width_) * static_cast<std::size_t>(height_);
+        if (num_cells > max_cells) return;
+
+        slots_.assign(num_cells, no_slot);
+        for (int y = 0; y < height_; ++y)
+            for (int x = 0; x < width_; ++x)
+                if (!map.is_wall(vec2i{x, y})) slots_[cell_index({x, y})] = num_slots_++;
+
+        build(map);
+    }
+
+    [[nodiscard]] bool empty() const { return entries_.empty(); }
+    [[nodiscard]] std::size_t memory_footprint() const
+    {
+        return entries_.size() * sizeof(entry) + slots_.size() * sizeof(std::int32_t);
+    }
+
+    //  The wall hit for the ray from pos in direction dir (a table lookup plus a ray-plane intersection or,
+    // if the looked up face is not hit by the ray, a cast through the map)
+    template <typename Map>
+    [[nodiscard]] wall_hit compute_wall_hit(const Map& map, const vec2f& pos, const vec2f& dir,
+                                            bool& is_fallback) const
+    {
+        const auto face = lookup(pos, dir);
+        is_fallback = !face.has_value();
+        if (face)
+        {
+            const auto hit = intersect_wall_face(pos, dir, *face);
+            const auto along = face->is_x ? pos.y + hit.distance * dir.y : pos.x + hit.distance * dir.x;
+            const auto face_begin = static_cast<float>(face->is_x ? face->cell.y : face->cell.x);
+            if ((hit.distance > 0.0f) and (along >= face_begin) and (along <= face_begin + 1.0f)) return hit;
+            is_fallback = true;
+        }
+
+        return ::compute_wall_hit(map, pos, dir);
+    }
+
+    // Compute the wall hit for each column (the ray of column i is cam.ray(ray_offsets[i])). The rays that
+    // fell back to the DDA are reported as the number of rays cast.
+    template <typename Map>
+    ray_stats compute_wall_hits(const Map& map, const std::span<wall_hit> hits, const camera& cam,
+                                const std::span<const float> ray_offsets) const
+    {
+        auto stats = ray_stats{.columns = hits.size()};
+        for (std::size_t i = 0; i < hits.size(); ++i)
+        {
+            auto is_fallback = false;
+            hits[i] = compute_wall_hit(map, cam.pos, cam.ray(ray_offsets[i]), is_fallback);
+            stats.rays_cast += is_fallback ? 1 : 0;
+        }
+
+        return stats;
+    }
+
+    //  Save the table to a file (together with the map it was built for) or load a table that was saved
+    // for the same map and resolution. Loading fails (and returns nothing) if the file does not exist or
+    // does not match.
+    [[nodiscard]] bool save(const char* path) const
+    {
+        auto* file = std::fopen(path, "wb");
+        if (file == nullptr) return false;
+
+        const auto header = file_header{.width = width_,
+                                        .height = height_,
+                                        .positions_per_cell = positions_per_cell_,
+                                        .num_angles = num_angles_,
+                                        .num_slots = num_slots_};
+        const auto write = [file](const auto& data) {
+            return std::fwrite(data.data(), sizeof(data[0]), data.size(), file) == data.size();
+        };
+        const auto is_written =
+            (std::fwrite(&header, sizeof(header), 1, file) == 1) and write(slots_) and write(entries_);
+        return (std::fclose(file) == 0) and is_written;
+    }
+
+    template <typename Map>
+    [[nodiscard]] static std::optional<wall_hit_table> load(const char* path, const Map& map,
+                                                            const int positions_per_cell = 8,
+                                                            const int num_angles = 1024)
+    {
+        auto* file = std::fopen(path, "rb");
+        if (file == nullptr) return std::nullopt;
+
+        auto table = wall_hit_table(map.width(), map.height(), positions_per_cell, num_angles);
+        auto header = file_header{};
+        auto is_valid = (std::fread(&header, sizeof(header), 1, file) == 1) and
+                        (std::memcmp(header.magic, file_header{}.magic, sizeof(header.magic)) == 0) and
+                        (header.width == table.width_) and (header.height == table.height_) and
+                        (header.positions_per_cell == table.positions_per_cell_) and
+                        (header.num_angles == table.num_angles_) and (header.num_slots >= 0) and
+                        (header.num_slots <= table.width_ * table.height_);
+        if (is_valid)
+        {
+            table.num_slots_ = header.num_slots;
+            table.slots_.resize(static_cast<std::size_t>(table.width_ * table.height_));
+            table.entries_.resize(table.num_entries());
+            const auto read = [file](auto& data) {
+                return std::fread(data.data(), sizeof(data[0]), data.size(), file) == data.size();
+            };
+            is_valid = read(table.slots_) and read(table.entries_);
+        }
+        std::fclose(file);
+
+        // the table must have been built for the same map: the walls are where the slots say they are, all
+        // other slots must refer to entries in the table and every entry must be the face of a cell of the map
+        for (int y = 0; is_valid and (y < table.height_); ++y)
+        {
+            for (int x = 0; is_valid and (x < table.width_); ++x)
+            {
+                const auto slot = table.slots_[table.cell_index({x, y})];
+                is_valid = map.is_wall(vec2i{x, y}) ? (slot == no_slot) : ((slot >= 0) and (slot < table.num_slots_));
+            }
+        }
+        const auto num_cells = static_cast<std::size_t>(table.width_) * static_cast<std::size_t>(table.height_);
+        is_valid = is_valid and std::ranges::all_of(table.entries_, [num_cells](const entry e) {
+                       return static_cast<std::size_t>(e >> 1) < num_cells;
+                   });
+
+        return is_valid ? std::optional(std::move(table)) : std::nullopt;
+    }
+
+    // Load the table from the cache file if there is one that matches, otherwise build it (and save it)
+    template <typename Map>
+    [[nodiscard]] static wall_hit_table load_or_build(const Map& map, const char* cache_path)
+    {
+        if (cache_path != nullptr)
+            if (auto table = load(cache_path, map)) return std::move(*table);
+
+        auto table = wall_hit_table(map);
+        if (cache_path != nullptr) static_cast<void>(table.save(cache_path));
+        return table;
+    }
+
+private:
+    using entry = std::uint16_t;
+    constexpr static std::int32_t no_slot = -1;
+
+    struct file_header
+    {
+        char magic[8] = {'w', 's', 't', 'l', 'u', 't', '0', '2'};
+        int width = 0;
+        int height = 0;
+        int positions_per_cell = 0;
+        int num_angles = 0;
+        std::int32_t num_slots = 0;
+    };
+
+    wall_hit_table(const int width, const int height, const int positions_per_cell, const int num_angles)
+        : width_(width)
+        , height_(height)
+        , positions_per_cell_(std::max(1, positions_per_cell))
+        , num_angles_(std::max(4, num_angles))
+    {
+    }
+
+    // The diamond angle of a direction in [0, 4): 0 is +x, 1 is +y, 2 is -x and 3 is -y
+    static float diamond_angle(const vec2f& dir)
+    {
+        const auto p = dir.y / (std::abs(dir.x) + std::abs(dir.y));
+        return (dir.x >= 0.0f) ? ((dir.y >= 0.0f) ? p : 4.0f + p) : 2.0f - p;
+    }
+
+    // The (unnormalized) direction with the given diamond angle
+    static vec2f diamond_direction(const float angle)
+    {
+        const auto p = (angle < 1.0f) ? angle : (angle < 3.0f) ? 2.0f - angle : angle - 4.0f;
+        const auto x = 1.0f - std::abs(p);
+        return {((angle < 1.0f) or (angle >= 3.0f)) ? x : -x, p};
+    }
+
+    [[nodiscard]] std::size_t cell_index(const vec2i& cell) const
+    {
+        return static_cast<std::size_t>(cell.y) * static_cast<std::size_t>(width_) + static_cast<std::size_t>(cell.x);
+    }
+
+    [[nodiscard]] std::size_t entries_per_slot() const
+    {
+        const auto num_positions = positions_per_cell_ * positions_per_cell_;
+        return static_cast<std::size_t>(num_positions) * static_cast<std::size_t>(num_angles_);
+    }
+
+    [[nodiscard]] std::size_t num_entries() const { return static_cast<std::size_t>(num_slots_) * entries_per_slot(); }
+
+    static entry encode(const wall_face& face, const int width)
+    {
+        return static_cast<entry>(((face.cell.y * width + face.cell.x) << 1) | (face.is_x ? 1 : 0));
+    }
+
+    [[nodiscard]] wall_face decode(const entry e) const
+    {
+        const auto cell = static_cast<int>(e >> 1);
+        return {.cell = {cell % width_, cell / width_}, .is_x = (e & 1) != 0};
+    }
+
+    //  The face hit by the samples around the pose, or nothing if they don't all hit the same face or the pose is
+    // not in an empty cell of the table
+    [[nodiscard]] std::optional<wall_face> lookup(const vec2f& pos, const vec2f& dir) const
+    {
+        const auto cell = to_vec2i(pos);
+        const auto is_inside = (static_cast<unsigned>(cell.x) < static_cast<unsigned>(width_)) and
+                               (static_cast<unsigned>(cell.y) < static_cast<unsigned>(height_));
+        if (!is_inside or entries_.empty()) return std::nullopt;
+
+        const auto slot = slots_[cell_index(cell)];
+        if (slot == no_slot) return std::nullopt;
+
+        // the sample positions below (or left of) the position, the ones above are the next ones (see
+        // sample_position)
+        const auto n = positions_per_cell_;
+        const auto sub_position = [n](const float p, const int cell) {
+            const auto spacing = static_cast<float>(std::max(1, n - 1));
+            return std::clamp(static_cast<int>((p - static_cast<float>(cell)) * spacing), 0, std::max(0, n - 2));
+        };
+        const auto sub_x = sub_position(pos.x, cell.x);
+        const auto sub_y = sub_position(pos.y, cell.y);
+        const auto angle = static_cast<int>(diamond_angle(dir) * static_cast<float>(num_angles_) * 0.25f);
+        const auto angles = std::array{angle % num_angles_, (angle + 1) % num_angles_};
+
+        const auto* entries = entries_.data() + static_cast<std::size_t>(slot) * entries_per_slot();
+        const auto first = entries[static_cast<std::size_t>((sub_y * n + sub_x) * num_angles_ + angles[0])];
+        const auto num_sub_positions = std::min(2, n);
+        for (int dy = 0; dy < num_sub_positions; ++dy)
+        {
+            for (int dx = 0; dx < num_sub_positions; ++dx)
+            {
+                const auto position = static_cast<std::size_t>(((sub_y + dy) * n + sub_x + dx) * num_angles_);
+                const auto* samples = entries + position;
+                if ((samples[angles[0]] != first) or (samples[angles[1]] != first)) return std::nullopt;
+            }
+        }
+
+        return decode(first);
+    }
+
+    // The position of sample sub (in [0, positions_per_cell)) along an axis of a cell, from one edge of the cell to
+    // the other (or the center for a single position)
+    [[nodiscard]] float sample_position(const int cell, const int sub) const
+    {
+        if (positions_per_cell_ == 1) return static_cast<float>(cell) + 0.5f;
+        return static_cast<float>(cell) + static_cast<float>(sub) / static_cast<float>(positions_per_cell_ - 1);
+    }
+
+    // Cast the rays for all sample poses. The slots are split evenly over as many threads as there are cores.
+    template <typename Map>
+    void build(const Map& map)
+    {
+        entries_.resize(num_entries());
+
+        const auto build_slots = [&](const std::int32_t first, const std::int32_t last) {
+            const auto n = positions_per_cell_;
+            for (int y = 0; y < height_; ++y)
+            {
+                for (int x = 0; x < width_; ++x)
+                {
+                    const auto slot = slots_[cell_index({x, y})];
+                    if ((slot < first) or (slot >= last)) continue;
+
+                    auto* entries = entries_.data() + static_cast<std::size_t>(slot) * entries_per_slot();
+                    for (int sub_y = 0; sub_y < n; ++sub_y)
+                    {
+                        for (int sub_x = 0; sub_x < n; ++sub_x)
+                        {
+                            const auto pos = vec2f{sample_position(x, sub_x), sample_position(y, sub_y)};
+                            for (int angle = 0; angle < num_angles_; ++angle)
+                            {
+                                const auto dir = diamond_direction(4.0f * static_cast<float>(angle) / num_angles_);
+                                *entries++ = encode(find_wall_face(map, pos, dir), width_);
+                            }
+                        }
+                    }
+                }
+            }
+        };
+
+        const auto num_threads = static_cast<std::int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+        const auto slots_per_thread = (num_slots_ + num_threads - 1) / num_threads;
+        auto threads = std::vector<std::jthread>{};
+        for (std::int32_t first = 0; first < num_slots_; first += slots_per_thread)
+            threads.emplace_back(build_slots, first, std::min(num_slots_, first + slots_per_thread));
+    }
+
+    int width_ = 0;
+    int height_ = 0;
+    int positions_per_cell_ = 1;
+    int num_angles_ = 4;
+    std::int32_t num_slots_ = 0;
+    std::vector<std::int32_t> slots_;  // the index of the entries of each empty cell (no_slot for walls)
+    std::vector<entry> entries_;
+};